@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 
 static void init_options(cli_options_t *options) {
     memset(options, 0, sizeof(cli_options_t));
@@ -34,7 +36,10 @@ void print_usage(const char *program_name) {
     printf("      --folders           Include folders in results\n");
     printf("      --folders-only      Return only folders (no files)\n");
     printf("  -q, --quiet             Suppress progress/summary output\n");
-    printf("      --no-skip           Don't skip common directories (node_modules, .git, etc.)\n\n");
+    printf("      --no-skip           Don't skip common directories (node_modules, .git, etc.)\n");
+    printf("  -x, --one-file-system   Don't descend into other filesystems\n");
+    printf("      --pseudo-fs         Descend into /proc, /sys and other pseudo filesystems\n");
+    printf("      --unique-inodes     Report each hard-linked file only once\n\n");
     printf("      --color <when>      Color output: auto|always|never\n\n");
 
     printf("Filters:\n");
@@ -49,14 +54,24 @@ void print_usage(const char *program_name) {
     printf("      --max-results <n>   Maximum number of results (0 = unlimited)\n\n");
 
     printf("Performance:\n");
-    printf("  -j, --threads <n>   Number of worker threads (0 = auto)\n");
+    printf("  -j, --threads <n>   Run exactly n worker threads (0 = auto, tuned by throughput)\n");
+    printf("      --tune-threads  Treat --threads as a ceiling and tune the count below it\n");
+    printf("      --pin-threads   Pin workers to CPUs, filling one NUMA node at a time\n");
     printf("      --timeout <ms>  Search timeout in milliseconds\n");
-    printf("      --stats         Show real-time thread pool statistics\n\n");
+    printf("      --max-open-dirs <n> Directory handles held by queued work (0 = auto)\n");
+    printf("      --device-threads <n> Directories read at once per device (0 = auto)\n");
+    printf("      --io-uring      Batch metadata and directory opens via io_uring (Linux)\n");
+    printf("      --order <order> Traversal order: dfs|bfs|shallow-first (default: dfs)\n");
+    printf("      --stats         Show thread pool statistics and per-phase worker time\n\n");
 
     printf("Output:\n");
     printf("      --preview [<n>]     Show preview of text files (default: 10 lines)\n");
     printf("      --out <file>        Write output to file\n");
-    printf("      --json              Output results as JSON\n\n");
+    printf("      --json              Output results as JSON\n");
+    printf("      --sort <key>        Sort results: path|name|size|mtime|depth (ascending)\n");
+    printf("      --top <n>           Only the n largest (or newest) results, greatest first;\n");
+    printf("                          with --sort, those n results in --sort order\n");
+    printf("      --by <key>          Key for --top: size|mtime (default: size)\n\n");
 
     printf("General:\n");
     printf("  -h, --help          Show this help message\n");
@@ -100,6 +115,7 @@ static bool is_path(const char *arg) {
 int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_options_t *options) {
     criteria_init(criteria);
     init_options(options);
+    bool top_by_given = false;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
@@ -166,6 +182,12 @@ int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_
             criteria->use_regex = true;
         } else if (strcmp(argv[i], "--no-skip") == 0) {
             criteria->skip_common_dirs = false;
+        } else if (strcmp(argv[i], "--one-file-system") == 0 || strcmp(argv[i], "-x") == 0) {
+            criteria->one_file_system = true;
+        } else if (strcmp(argv[i], "--pseudo-fs") == 0) {
+            criteria->include_pseudo_fs = true;
+        } else if (strcmp(argv[i], "--unique-inodes") == 0) {
+            criteria->unique_inodes = true;
         } else if (strcmp(argv[i], "--follow-symlinks") == 0 || strcmp(argv[i], "-L") == 0) {
             criteria->follow_symlinks = true;
         } else if (strcmp(argv[i], "--include-hidden") == 0 || strcmp(argv[i], "-H") == 0) {
@@ -285,6 +307,89 @@ int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_
                 return -1;
             }
             criteria->max_threads = (size_t)strtoull(argv[i], NULL, 10);
+        } else if (strcmp(argv[i], "--tune-threads") == 0) {
+            criteria->tune_threads = true;
+        } else if (strcmp(argv[i], "--pin-threads") == 0) {
+            criteria->pin_threads = true;
+        } else if (strcmp(argv[i], "--max-open-dirs") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            criteria->max_open_dirs = (size_t)strtoull(argv[i], NULL, 10);
+        } else if (strcmp(argv[i], "--device-threads") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            criteria->device_threads = (size_t)strtoull(argv[i], NULL, 10);
+        } else if (strcmp(argv[i], "--io-uring") == 0) {
+            criteria->use_io_uring = true;
+        } else if (strcmp(argv[i], "--order") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            if (_stricmp(argv[i], "dfs") == 0) {
+                criteria->order = SEARCH_ORDER_DFS;
+            } else if (_stricmp(argv[i], "bfs") == 0) {
+                criteria->order = SEARCH_ORDER_BFS;
+            } else if (_stricmp(argv[i], "shallow-first") == 0) {
+                criteria->order = SEARCH_ORDER_SHALLOW_FIRST;
+            } else {
+                fprintf(stderr, "Error: Invalid order '%s'. Use dfs|bfs|shallow-first.\n", argv[i]);
+                criteria_cleanup(criteria);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--sort") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            if (_stricmp(argv[i], "path") == 0) {
+                criteria->sort = SEARCH_SORT_PATH;
+            } else if (_stricmp(argv[i], "name") == 0) {
+                criteria->sort = SEARCH_SORT_NAME;
+            } else if (_stricmp(argv[i], "size") == 0) {
+                criteria->sort = SEARCH_SORT_SIZE;
+            } else if (_stricmp(argv[i], "mtime") == 0) {
+                criteria->sort = SEARCH_SORT_MTIME;
+            } else if (_stricmp(argv[i], "depth") == 0) {
+                criteria->sort = SEARCH_SORT_DEPTH;
+            } else {
+                fprintf(stderr, "Error: Invalid sort key '%s'. Use path|name|size|mtime|depth.\n", argv[i]);
+                criteria_cleanup(criteria);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--top") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            char *end = NULL;
+            errno = 0;
+            unsigned long long top = isdigit((unsigned char)argv[i][0]) ? strtoull(argv[i], &end, 10) : 0;
+            if (!end || *end != '\0' || top == 0 || errno == ERANGE || top > SIZE_MAX) {
+                fprintf(stderr, "Error: Invalid --top count '%s'. Use a positive whole number.\n", argv[i]);
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            criteria->top_count = (size_t)top;
+        } else if (strcmp(argv[i], "--by") == 0) {
+            if (++i >= argc) {
+                criteria_cleanup(criteria);
+                return -1;
+            }
+            top_by_given = true;
+            if (_stricmp(argv[i], "size") == 0) {
+                criteria->top_by = SEARCH_SORT_SIZE;
+            } else if (_stricmp(argv[i], "mtime") == 0) {
+                criteria->top_by = SEARCH_SORT_MTIME;
+            } else {
+                fprintf(stderr, "Error: Invalid --by key '%s'. Use size|mtime.\n", argv[i]);
+                criteria_cleanup(criteria);
+                return -1;
+            }
         } else if (strcmp(argv[i], "--timeout") == 0) {
             if (++i >= argc) {
                 criteria_cleanup(criteria);
@@ -326,6 +431,7 @@ int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_
             }
         } else if (strcmp(argv[i], "--stats") == 0) {
             options->show_stats = true;
+            criteria->time_phases = true;
         } else {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             criteria_cleanup(criteria);
@@ -333,10 +439,19 @@ int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_
         }
     }
 
+    if (top_by_given && criteria->top_count == 0) {
+        fprintf(stderr, "Error: --by only applies together with --top.\n");
+        criteria_cleanup(criteria);
+        return -1;
+    }
+
+    // Only JSON prints size and modification time; --top and --sort load just their key
+    criteria->report_metadata = options->json_output;
+
     return 0;
 }
 
-int output_results(const search_result_t *results, size_t count, const cli_options_t *options, const search_criteria_t *criteria) {
+int output_results(const search_results_t *results, size_t count, const cli_options_t *options, const search_criteria_t *criteria) {
     FILE *fp = stdout;
 
     if (options->output_file) {
@@ -24,6 +24,6 @@ typedef struct cli_options {
 int parse_command_line(int argc, char *argv[], search_criteria_t *criteria, cli_options_t *options);
 void print_usage(const char *program_name);
 void print_version(void);
-int output_results(const search_result_t *results, size_t count, const cli_options_t *options, const search_criteria_t *criteria);
+int output_results(const search_results_t *results, size_t count, const cli_options_t *options, const search_criteria_t *criteria);
 
 #endif
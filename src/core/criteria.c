@@ -14,10 +14,20 @@ void criteria_init(search_criteria_t *criteria) {
     criteria->use_glob = false;
     criteria->use_regex = false;
     criteria->skip_common_dirs = true;
+    criteria->one_file_system = false;
+    criteria->include_pseudo_fs = false;
+    criteria->unique_inodes = false;
     criteria->preview_mode = false;
     criteria->preview_lines = 10;
     criteria->file_type_filter = NULL;
     criteria->max_threads = 0;
+    criteria->tune_threads = false;
+    criteria->max_open_dirs = 0;
+    criteria->device_threads = 0;
+    criteria->use_io_uring = false;
+    criteria->order = SEARCH_ORDER_DFS;
+    criteria->pin_threads = false;
+    criteria->time_phases = false;
     criteria->timeout_ms = 300000;    // 5 minutes
     criteria->follow_symlinks = false;
     criteria->include_hidden = false;
@@ -25,6 +35,10 @@ void criteria_init(search_criteria_t *criteria) {
     criteria->max_depth = SIZE_MAX;
     criteria->include_directories = false;
     criteria->include_files = true;
+    criteria->report_metadata = false;
+    criteria->sort = SEARCH_SORT_NONE;
+    criteria->top_count = 0;
+    criteria->top_by = SEARCH_SORT_SIZE;
 }
 
 bool criteria_parse_extensions(search_criteria_t *criteria, const char *extensions_str) {
@@ -225,3 +239,29 @@ bool criteria_file_type_matches(const char *filename, const search_criteria_t *c
 
     return false;
 }
+
+unsigned criteria_metadata_plan(const search_criteria_t *criteria) {
+    if (!criteria) return 0;
+
+    unsigned plan = 0;
+    if (criteria->has_exact_size || criteria->has_min_size || criteria->has_max_size) {
+        plan |= PLATFORM_METADATA_SIZE;
+    }
+    if (criteria->has_after_time || criteria->has_before_time) {
+        plan |= PLATFORM_METADATA_MTIME;
+    }
+    if (criteria->unique_inodes) {
+        plan |= PLATFORM_METADATA_LINKS;
+    }
+
+    // --top and --sort read only the key they order by
+    if (criteria->top_count > 0) {
+        plan |= criteria->top_by == SEARCH_SORT_MTIME ? PLATFORM_METADATA_MTIME : PLATFORM_METADATA_SIZE;
+    }
+    if (criteria->sort == SEARCH_SORT_SIZE) {
+        plan |= PLATFORM_METADATA_SIZE;
+    } else if (criteria->sort == SEARCH_SORT_MTIME) {
+        plan |= PLATFORM_METADATA_MTIME;
+    }
+    return plan;
+}
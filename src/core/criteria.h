@@ -1,10 +1,17 @@
 #ifndef CRITERIA_H
 #define CRITERIA_H
 
-#include <windows.h>
+#include "../platform/compat.h"
+#include "results.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef enum {
+    SEARCH_ORDER_DFS,           // finish a subtree before the next; least memory on wide trees
+    SEARCH_ORDER_BFS,           // directories roughly in discovery order
+    SEARCH_ORDER_SHALLOW_FIRST  // always the shallowest queued directory next
+} search_order_t;
+
 typedef struct search_criteria {
     char *root_path;
     char *search_term;
@@ -19,6 +26,9 @@ typedef struct search_criteria {
     bool use_glob;
     bool use_regex;
     bool skip_common_dirs;
+    bool one_file_system;       // don't cross into other mounted filesystems
+    bool include_pseudo_fs;     // descend into /proc, /sys and similar
+    bool unique_inodes;         // report each hard-linked file once
     bool preview_mode;
     size_t preview_lines;
     char *file_type_filter;
@@ -28,7 +38,14 @@ typedef struct search_criteria {
     bool has_after_time;
     bool has_before_time;
 
-    size_t max_threads;
+    size_t max_threads;     // worker count; 0 = auto, tuned by throughput
+    bool tune_threads;      // tune below max_threads instead of running exactly that many
+    size_t max_open_dirs;   // queued directory handles; 0 = derive from the descriptor limit
+    size_t device_threads;  // directories read at once per device; 0 = share workers evenly
+    bool use_io_uring;      // batch statx/openat per directory where the kernel allows
+    search_order_t order;   // which queued directory to read next
+    bool pin_threads;       // pin workers to CPUs, NUMA node by node
+    bool time_phases;       // per-worker phase timers (open/readdir/match/result)
     DWORD timeout_ms;
     bool follow_symlinks;
     bool include_hidden;
@@ -36,6 +53,10 @@ typedef struct search_criteria {
     size_t max_depth;
     bool include_directories;
     bool include_files;
+    bool report_metadata;   // results must carry size/mtime (e.g. JSON output)
+    search_sort_t sort;     // order of the returned results; needs a result set
+    size_t top_count;       // keep only this many greatest results by top_by; 0 = all
+    search_sort_t top_by;   // SEARCH_SORT_SIZE or SEARCH_SORT_MTIME
 } search_criteria_t;
 
 void criteria_init(search_criteria_t *criteria);
@@ -54,4 +75,7 @@ bool criteria_time_matches(const FILETIME *file_time, const search_criteria_t *c
 
 bool criteria_file_type_matches(const char *filename, const search_criteria_t *criteria);
 
+// PLATFORM_METADATA_* fields that size/time filters, --top and --sort will read
+unsigned criteria_metadata_plan(const search_criteria_t *criteria);
+
 #endif
@@ -4,7 +4,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <windows.h>
 #include <stdio.h>
 
 const char g_ascii_tolower[256] = {
@@ -0,0 +1,494 @@
+#include "results.h"
+#include "../platform/threading.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SEARCH_RESULT_CHUNK_SIZE (64 * 1024)
+
+struct search_result_chunk {
+    struct search_result_chunk *next;
+    size_t size;            // bytes, header included
+    size_t count;
+    char *path_top;         // paths occupy [path_top, end of chunk)
+    search_sort_t sorted_by;
+    search_result_t records[];
+};
+
+struct search_results {
+    platform_mutex_t lock;  // chunk list only
+    search_result_chunk_t *head;
+    search_result_chunk_t *tail;
+    const search_result_t **order;  // set by search_results_sort
+    size_t order_count;
+};
+
+typedef int (*search_result_compare_t)(const void *a, const void *b);
+
+struct search_top {
+    search_result_compare_t compare;
+    bool path_keys;                 // compare reads name_offset/depth
+    size_t capacity;                // the k of --top
+    size_t count;
+    size_t allocated;               // grows toward capacity as results arrive
+    search_result_t *entries;       // min-heap under compare
+};
+
+#define SEARCH_TOP_INITIAL 64
+
+// Merge source: the unmerged rest of one sorted chunk
+typedef struct {
+    const search_result_t *next;
+    const search_result_t *end;
+} search_merge_cursor_t;
+
+search_results_t* search_results_create(void) {
+    search_results_t *results = (search_results_t*)calloc(1, sizeof(search_results_t));
+    if (!results) return NULL;
+
+    platform_mutex_init(&results->lock);
+    return results;
+}
+
+void free_search_results(search_results_t *results) {
+    if (!results) return;
+
+    search_result_chunk_t *chunk = results->head;
+    while (chunk) {
+        search_result_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    free(results->order);
+    platform_mutex_destroy(&results->lock);
+    free(results);
+}
+
+size_t search_results_count(const search_results_t *results) {
+    size_t count = 0;
+    for (const search_result_chunk_t *chunk = results ? results->head : NULL; chunk; chunk = chunk->next) {
+        count += chunk->count;
+    }
+    return count;
+}
+
+void search_results_iter_init(search_results_iter_t *iter, const search_results_t *results) {
+    iter->chunk = results ? results->head : NULL;
+    iter->index = 0;
+    iter->order = results ? results->order : NULL;
+    iter->order_count = results ? results->order_count : 0;
+}
+
+const search_result_t* search_results_next(search_results_iter_t *iter) {
+    if (iter->order) {
+        return iter->index < iter->order_count ? iter->order[iter->index++] : NULL;
+    }
+    while (iter->chunk && iter->index >= iter->chunk->count) {
+        iter->chunk = iter->chunk->next;
+        iter->index = 0;
+    }
+    return iter->chunk ? &iter->chunk->records[iter->index++] : NULL;
+}
+
+static void search_result_copy_path(char *stored, const char *path, size_t path_len) {
+    memcpy(stored, path, path_len);
+    stored[path_len] = '\0';
+#ifdef _WIN32
+    for (char *p = stored; *p; ++p) {
+        if (*p == '/') {
+            *p = '\\';
+        }
+    }
+#endif
+}
+
+static bool search_result_is_separator(char c) {
+#ifdef _WIN32
+    return c == '\\' || c == '/';
+#else
+    return c == '/';
+#endif
+}
+
+// The name and depth sort keys, so comparisons never rescan the path
+static void search_result_set_path_keys(search_result_t *result, const char *path) {
+    uint32_t name_offset = 0;
+    uint32_t depth = 0;
+    for (uint32_t i = 0; i < result->path_len; i++) {
+        if (search_result_is_separator(path[i])) {
+            name_offset = i + 1;
+            depth++;
+        }
+    }
+    result->name_offset = name_offset;
+    result->depth = depth;
+}
+
+search_result_chunk_t* search_result_chunk_create(size_t path_len) {
+    // A path too long for a regular chunk gets one sized to fit it alone
+    size_t size = sizeof(search_result_chunk_t) + sizeof(search_result_t) + path_len + 1;
+    if (size < SEARCH_RESULT_CHUNK_SIZE) {
+        size = SEARCH_RESULT_CHUNK_SIZE;
+    }
+
+    search_result_chunk_t *chunk = (search_result_chunk_t*)malloc(size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    search_result_chunk_reset(chunk);
+    return chunk;
+}
+
+void search_result_chunk_reset(search_result_chunk_t *chunk) {
+    chunk->count = 0;
+    chunk->path_top = (char*)chunk + chunk->size;
+    chunk->sorted_by = SEARCH_SORT_NONE;
+}
+
+void search_result_chunk_destroy(search_result_chunk_t *chunk) {
+    free(chunk);
+}
+
+search_result_chunk_t* search_results_add_chunk(search_results_t *results, size_t path_len) {
+    search_result_chunk_t *chunk = search_result_chunk_create(path_len);
+    if (!chunk) return NULL;
+
+    platform_mutex_lock(&results->lock);
+    if (results->tail) {
+        results->tail->next = chunk;
+    } else {
+        results->head = chunk;
+    }
+    results->tail = chunk;
+    platform_mutex_unlock(&results->lock);
+    return chunk;
+}
+
+const search_result_t* search_result_chunk_append(search_result_chunk_t *chunk, const char *path, size_t path_len,
+                                                  bool is_directory, uint64_t size, FILETIME mtime) {
+    if (!chunk || path_len > UINT32_MAX) return NULL;
+
+    size_t room = (size_t)(chunk->path_top - (char*)&chunk->records[chunk->count]);
+    if (room < sizeof(search_result_t) + path_len + 1) {
+        return NULL;
+    }
+
+    char *stored = chunk->path_top - (path_len + 1);
+    search_result_copy_path(stored, path, path_len);
+    chunk->path_top = stored;
+    chunk->sorted_by = SEARCH_SORT_NONE;
+
+    search_result_t *result = &chunk->records[chunk->count++];
+    result->path = stored;
+    result->size = size;
+    result->mtime = mtime;
+    result->path_len = (uint32_t)path_len;
+    result->is_directory = is_directory;
+    search_result_set_path_keys(result, stored);
+    return result;
+}
+
+const search_result_t* search_result_chunk_records(const search_result_chunk_t *chunk) {
+    return chunk->records;
+}
+
+size_t search_result_chunk_count(const search_result_chunk_t *chunk) {
+    return chunk->count;
+}
+
+// One comparator per key, each with the path as tie-break, so the order is
+// total and the same whatever thread found what
+
+static int search_compare_path(const void *a, const void *b) {
+    return strcmp(((const search_result_t*)a)->path, ((const search_result_t*)b)->path);
+}
+
+static int search_compare_name(const void *a, const void *b) {
+    const search_result_t *result_a = (const search_result_t*)a;
+    const search_result_t *result_b = (const search_result_t*)b;
+    int order = strcmp(result_a->path + result_a->name_offset, result_b->path + result_b->name_offset);
+    return order != 0 ? order : search_compare_path(a, b);
+}
+
+static int search_compare_size(const void *a, const void *b) {
+    uint64_t size_a = ((const search_result_t*)a)->size;
+    uint64_t size_b = ((const search_result_t*)b)->size;
+    if (size_a != size_b) return size_a < size_b ? -1 : 1;
+    return search_compare_path(a, b);
+}
+
+static uint64_t search_result_mtime(const search_result_t *result) {
+    return ((uint64_t)result->mtime.dwHighDateTime << 32) | result->mtime.dwLowDateTime;
+}
+
+static int search_compare_mtime(const void *a, const void *b) {
+    uint64_t mtime_a = search_result_mtime((const search_result_t*)a);
+    uint64_t mtime_b = search_result_mtime((const search_result_t*)b);
+    if (mtime_a != mtime_b) return mtime_a < mtime_b ? -1 : 1;
+    return search_compare_path(a, b);
+}
+
+static int search_compare_depth(const void *a, const void *b) {
+    uint32_t depth_a = ((const search_result_t*)a)->depth;
+    uint32_t depth_b = ((const search_result_t*)b)->depth;
+    if (depth_a != depth_b) return depth_a < depth_b ? -1 : 1;
+    return search_compare_path(a, b);
+}
+
+static search_result_compare_t search_sort_comparator(search_sort_t key) {
+    switch (key) {
+        case SEARCH_SORT_PATH:  return search_compare_path;
+        case SEARCH_SORT_NAME:  return search_compare_name;
+        case SEARCH_SORT_SIZE:  return search_compare_size;
+        case SEARCH_SORT_MTIME: return search_compare_mtime;
+        case SEARCH_SORT_DEPTH: return search_compare_depth;
+        default:                return NULL;
+    }
+}
+
+void search_result_chunk_sort(search_result_chunk_t *chunk, search_sort_t key) {
+    search_result_compare_t compare = search_sort_comparator(key);
+    if (!chunk || !compare || chunk->sorted_by == key) return;
+
+    qsort(chunk->records, chunk->count, sizeof(search_result_t), compare);
+    chunk->sorted_by = key;
+}
+
+static void search_merge_sift_down(search_merge_cursor_t *heap, size_t count, size_t index,
+                                   search_result_compare_t compare) {
+    for (;;) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < count && compare(heap[left].next, heap[smallest].next) < 0) smallest = left;
+        if (right < count && compare(heap[right].next, heap[smallest].next) < 0) smallest = right;
+        if (smallest == index) return;
+
+        search_merge_cursor_t swap = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = swap;
+        index = smallest;
+    }
+}
+
+bool search_results_sort(search_results_t *results, search_sort_t key) {
+    if (!results) return true;
+
+    free(results->order);
+    results->order = NULL;
+    results->order_count = 0;
+
+    search_result_compare_t compare = search_sort_comparator(key);
+    if (!compare) return true;
+
+    // Chunks a writer left unsorted (a search that stopped early, say) are sorted here
+    size_t chunk_count = 0;
+    size_t total = 0;
+    for (search_result_chunk_t *chunk = results->head; chunk; chunk = chunk->next) {
+        if (chunk->count == 0) continue;
+        search_result_chunk_sort(chunk, key);
+        chunk_count++;
+        total += chunk->count;
+    }
+    if (total == 0) return true;
+
+    const search_result_t **order = (const search_result_t**)malloc(total * sizeof(*order));
+    search_merge_cursor_t *heap = (search_merge_cursor_t*)malloc(chunk_count * sizeof(*heap));
+    if (!order || !heap) {
+        free(order);
+        free(heap);
+        return false;
+    }
+
+    size_t heap_count = 0;
+    for (search_result_chunk_t *chunk = results->head; chunk; chunk = chunk->next) {
+        if (chunk->count == 0) continue;
+        heap[heap_count].next = chunk->records;
+        heap[heap_count].end = chunk->records + chunk->count;
+        heap_count++;
+    }
+    for (size_t i = heap_count / 2; i-- > 0;) {
+        search_merge_sift_down(heap, heap_count, i, compare);
+    }
+
+    size_t merged = 0;
+    while (heap_count > 0) {
+        order[merged++] = heap[0].next++;
+        if (heap[0].next == heap[0].end) {
+            heap[0] = heap[--heap_count];
+        }
+        search_merge_sift_down(heap, heap_count, 0, compare);
+    }
+    free(heap);
+
+    results->order = order;
+    results->order_count = merged;
+    return true;
+}
+
+search_top_t* search_top_create(size_t capacity, search_sort_t key) {
+    search_result_compare_t compare = search_sort_comparator(key);
+    if (!compare || capacity == 0) return NULL;
+
+    // A large k costs nothing until that many results turn up
+    size_t allocated = capacity < SEARCH_TOP_INITIAL ? capacity : SEARCH_TOP_INITIAL;
+    search_top_t *top = (search_top_t*)malloc(sizeof(search_top_t));
+    if (!top) return NULL;
+    top->entries = (search_result_t*)malloc(allocated * sizeof(search_result_t));
+    if (!top->entries) {
+        free(top);
+        return NULL;
+    }
+    top->compare = compare;
+    top->path_keys = key == SEARCH_SORT_NAME || key == SEARCH_SORT_DEPTH;
+    top->capacity = capacity;
+    top->count = 0;
+    top->allocated = allocated;
+    return top;
+}
+
+void search_top_destroy(search_top_t *top) {
+    if (!top) return;
+
+    for (size_t i = 0; i < top->count; i++) {
+        free((char*)top->entries[i].path);
+    }
+    free(top->entries);
+    free(top);
+}
+
+// Room for one more entry below capacity, doubling the array as needed
+static bool search_top_reserve(search_top_t *top) {
+    if (top->count < top->allocated) return true;
+
+    size_t allocated = top->allocated;
+    size_t grown = allocated > top->capacity / 2 ? top->capacity : allocated * 2;
+    if (grown > SIZE_MAX / sizeof(search_result_t)) return false;
+
+    search_result_t *entries = (search_result_t*)realloc(top->entries, grown * sizeof(search_result_t));
+    if (!entries) return false;
+    top->entries = entries;
+    top->allocated = grown;
+    return true;
+}
+
+static void search_top_sift_up(search_top_t *top, size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (top->compare(&top->entries[index], &top->entries[parent]) >= 0) return;
+
+        search_result_t swap = top->entries[index];
+        top->entries[index] = top->entries[parent];
+        top->entries[parent] = swap;
+        index = parent;
+    }
+}
+
+static void search_top_sift_down(search_top_t *top, size_t index) {
+    for (;;) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < top->count && top->compare(&top->entries[left], &top->entries[smallest]) < 0) smallest = left;
+        if (right < top->count && top->compare(&top->entries[right], &top->entries[smallest]) < 0) smallest = right;
+        if (smallest == index) return;
+
+        search_result_t swap = top->entries[index];
+        top->entries[index] = top->entries[smallest];
+        top->entries[smallest] = swap;
+        index = smallest;
+    }
+}
+
+// Takes ownership of candidate's path, freeing it if the candidate is
+// dropped; false (path untouched) if the heap could not grow
+static bool search_top_insert(search_top_t *top, const search_result_t *candidate) {
+    if (top->count < top->capacity) {
+        if (!search_top_reserve(top)) return false;
+        top->entries[top->count++] = *candidate;
+        search_top_sift_up(top, top->count - 1);
+        return true;
+    }
+    if (top->compare(candidate, &top->entries[0]) <= 0) {
+        free((char*)candidate->path);
+        return true;
+    }
+    free((char*)top->entries[0].path);
+    top->entries[0] = *candidate;
+    search_top_sift_down(top, 0);
+    return true;
+}
+
+bool search_top_offer(search_top_t *top, const char *path, size_t path_len,
+                      bool is_directory, uint64_t size, FILETIME mtime) {
+    if (!top || !path || path_len > UINT32_MAX) return false;
+
+    search_result_t candidate;
+    candidate.path = path;
+    candidate.size = size;
+    candidate.mtime = mtime;
+    candidate.path_len = (uint32_t)path_len;
+    candidate.is_directory = is_directory;
+    candidate.name_offset = 0;
+    candidate.depth = 0;
+    if (top->path_keys) {
+        search_result_set_path_keys(&candidate, path);
+    }
+
+    // Once full, most candidates lose to the root and are never copied
+    if (top->count == top->capacity && top->compare(&candidate, &top->entries[0]) <= 0) {
+        return true;
+    }
+
+    char *stored = (char*)malloc(path_len + 1);
+    if (!stored) return false;
+    search_result_copy_path(stored, path, path_len);
+    candidate.path = stored;
+    if (!search_top_insert(top, &candidate)) {
+        free(stored);
+        return false;
+    }
+    return true;
+}
+
+bool search_top_merge(search_top_t *into, search_top_t *from) {
+    if (!into || !from) return true;
+
+    // Taken from the back, so what could not move stays a valid heap prefix
+    while (from->count > 0) {
+        if (!search_top_insert(into, &from->entries[from->count - 1])) {
+            return false;
+        }
+        from->count--;
+    }
+    return true;
+}
+
+bool search_top_export(const search_top_t *top, search_results_t *results) {
+    if (!top || top->count == 0) return true;
+
+    // Popping the heap would give ascending order; sort a copy of the
+    // entries instead and walk it from the back
+    search_result_t *sorted = (search_result_t*)malloc(top->count * sizeof(search_result_t));
+    if (!sorted) return false;
+    memcpy(sorted, top->entries, top->count * sizeof(search_result_t));
+    qsort(sorted, top->count, sizeof(search_result_t), top->compare);
+
+    bool ok = true;
+    search_result_chunk_t *chunk = NULL;
+    for (size_t i = top->count; i-- > 0;) {
+        const search_result_t *entry = &sorted[i];
+        if (search_result_chunk_append(chunk, entry->path, entry->path_len, entry->is_directory,
+                                       entry->size, entry->mtime)) {
+            continue;
+        }
+        chunk = search_results_add_chunk(results, entry->path_len);
+        if (!chunk || !search_result_chunk_append(chunk, entry->path, entry->path_len, entry->is_directory,
+                                                  entry->size, entry->mtime)) {
+            ok = false;
+            break;
+        }
+    }
+    free(sorted);
+    return ok;
+}
@@ -0,0 +1,99 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include "../platform/compat.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct search_result {
+    const char *path;       // stored in the result set; valid until free_search_results
+    uint64_t size;
+    FILETIME mtime;
+    uint32_t path_len;
+    uint32_t name_offset;   // final path component starts at path + name_offset
+    uint32_t depth;         // path separators, counted once when stored
+    bool is_directory;
+} search_result_t;
+
+// Orders search_results_sort knows; all ascending, ties broken by path
+typedef enum {
+    SEARCH_SORT_NONE,       // as found
+    SEARCH_SORT_PATH,       // byte order, like LC_ALL=C sort
+    SEARCH_SORT_NAME,       // final path component
+    SEARCH_SORT_SIZE,
+    SEARCH_SORT_MTIME,
+    SEARCH_SORT_DEPTH       // path separators, so shallower paths first
+} search_sort_t;
+
+// Search results in chunked arenas. A chunk fills fixed-size records from
+// its front and packs their paths down from its back, so a result costs no
+// allocation of its own and teardown frees one block per chunk. Each writer
+// thread fills its own chunk; only linking a new chunk takes a lock.
+typedef struct search_result_chunk search_result_chunk_t;
+typedef struct search_results search_results_t;
+
+typedef struct {
+    const search_result_chunk_t *chunk;
+    size_t index;
+    const search_result_t *const *order;    // walked instead of the chunks once sorted
+    size_t order_count;
+} search_results_iter_t;
+
+search_results_t* search_results_create(void);
+void free_search_results(search_results_t *results);
+
+// Walks the chunks; call once writers are done
+size_t search_results_count(const search_results_t *results);
+
+void search_results_iter_init(search_results_iter_t *iter, const search_results_t *results);
+// NULL after the last result; in sorted order after search_results_sort
+const search_result_t* search_results_next(search_results_iter_t *iter);
+
+// Sort each chunk not already sorted by key, then k-way merge the chunks
+// into an order the iterator follows. Call once writers are done; false if
+// out of memory.
+bool search_results_sort(search_results_t *results, search_sort_t key);
+
+// Start a chunk with room for at least one path of path_len bytes and link
+// it onto results; thread-safe
+search_result_chunk_t* search_results_add_chunk(search_results_t *results, size_t path_len);
+
+// A chunk outside any result set, for callers that only stream results:
+// reset it once its records have been consumed, destroy it when done
+search_result_chunk_t* search_result_chunk_create(size_t path_len);
+void search_result_chunk_reset(search_result_chunk_t *chunk);
+void search_result_chunk_destroy(search_result_chunk_t *chunk);
+
+// Owner only. Copies path into the chunk; NULL when it has no room left.
+const search_result_t* search_result_chunk_append(search_result_chunk_t *chunk, const char *path, size_t path_len,
+                                                  bool is_directory, uint64_t size, FILETIME mtime);
+
+// Owner only. Sorts the chunk's records in place, so a writer can do its
+// share of search_results_sort on chunks it has finished filling.
+void search_result_chunk_sort(search_result_chunk_t *chunk, search_sort_t key);
+
+// Records appended so far, contiguous from index 0
+const search_result_t* search_result_chunk_records(const search_result_chunk_t *chunk);
+size_t search_result_chunk_count(const search_result_chunk_t *chunk);
+
+// The capacity greatest results by a sort key, in a min-heap whose root is
+// the next to drop. The heap grows with what it holds, up to capacity. Kept results own their paths; everything else is
+// rejected after one comparison. One owner at a time, no lock.
+typedef struct search_top search_top_t;
+
+search_top_t* search_top_create(size_t capacity, search_sort_t key);
+void search_top_destroy(search_top_t *top);
+
+// Keep the result if it ranks among the greatest so far; false if out of memory
+bool search_top_offer(search_top_t *top, const char *path, size_t path_len,
+                      bool is_directory, uint64_t size, FILETIME mtime);
+
+// Move what from holds into into, which must use the same key; from ends
+// empty, or keeps what did not fit if into ran out of memory (false)
+bool search_top_merge(search_top_t *into, search_top_t *from);
+
+// Append the kept results to results, greatest first; false if out of memory
+bool search_top_export(const search_top_t *top, search_results_t *results);
+
+#endif
@@ -3,31 +3,294 @@
 #include "pattern.h"
 #include "../platform/platform.h"
 #include "../platform/thread_pool.h"
+#include "../platform/threading.h"
 #include "criteria.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static thread_pool_stats_t last_thread_stats = {0};
 static bool last_thread_stats_valid = false;
+static search_phase_stats_t last_phase_stats = {0};
 
-typedef struct {
+// A directory to read. Works form a tree through parent references, so a
+// full path is only materialized (by walking names up the chain) when a
+// result matches or a directory has to be reopened by path.
+typedef struct directory_work {
     search_context_t *ctx;
-    char *directory_path;
+    struct directory_work *parent;  // holds a reference
+    atomic_size_t refs;
+    platform_dir_iter_t *dir;       // opened relative to the parent, or NULL to open by path
+    uint64_t device;                // scheduling key; see platform_dir_device
     size_t depth;
+    size_t path_len;                // strlen of the full path
+    size_t name_len;
+    char name[];                    // root: the root path as given
 } directory_work_t;
 
+#define SEARCH_DIR_BATCH_SIZE 256
+#define SEARCH_INLINE_STACK_SIZE 64
+#define SEARCH_NAME_ARENA_SIZE (64 * 1024)
+#define SEARCH_RESULT_PUBLISH 64    // results a worker collects before publishing them
+
+// What pass 1 of a batch decided for each entry
+#define SEARCH_ENTRY_RESULT  0x1u   // name filters passed; size/time still to check
+#define SEARCH_ENTRY_DESCEND 0x2u   // queue as a subdirectory
+
+// Per-worker scratch space, reused for every directory the worker reads
+typedef struct search_worker {
+    platform_name_arena_t names;
+    platform_dir_entry_t entries[SEARCH_DIR_BATCH_SIZE];
+    unsigned char actions[SEARCH_DIR_BATCH_SIZE];
+    platform_dir_entry_t *pending[SEARCH_DIR_BATCH_SIZE];
+    const char *child_names[SEARCH_DIR_BATCH_SIZE];
+    size_t child_slots[SEARCH_DIR_BATCH_SIZE];
+    platform_dir_iter_t *opened[SEARCH_DIR_BATCH_SIZE];
+    platform_dir_iter_t *child_dirs[SEARCH_DIR_BATCH_SIZE];
+    platform_io_engine_t *io;   // NULL: one syscall per entry
+    char *path;
+    size_t path_capacity;
+    // Subdirectories kept for this thread while every worker is busy; run
+    // depth-first once the current directory is done, and shared with the
+    // pool as soon as some worker goes idle
+    directory_work_t *inline_stack[SEARCH_INLINE_STACK_SIZE];
+    size_t inline_count;
+    // This worker's arena chunk; records from published on are not yet
+    // handed to the result callback. Without a result set (streaming) the
+    // chunk is private and reused after every publish.
+    search_result_chunk_t *chunk;
+    size_t published;
+    bool retaining;             // chunk belongs to ctx->results
+    search_sort_t sort;         // applied to each retained chunk once it is full
+    // --top: this worker's share, merged into ctx->top when it exits, and
+    // its matches not yet counted in ctx->total_results
+    search_top_t *top;
+    size_t top_pending;
+    // Written by this worker only; read live for --stats
+    bool time_phases;
+    atomic_uint_least64_t phase_ns[SEARCH_PHASE_COUNT];
+    search_context_t *ctx;      // NULL when not registered in ctx->workers
+    struct search_worker *next;
+} search_worker_t;
+
+static uint64_t search_phase_start(const search_worker_t *worker) {
+    return worker->time_phases ? platform_tick_ns() : 0;
+}
+
+// Charge the time since start to phase; returns now, the next phase's start
+static uint64_t search_phase_end(search_worker_t *worker, search_phase_t phase, uint64_t start) {
+    if (!worker->time_phases) return 0;
+
+    uint64_t now = platform_tick_ns();
+    atomic_store_explicit(&worker->phase_ns[phase],
+                          atomic_load_explicit(&worker->phase_ns[phase], memory_order_relaxed) + (now - start),
+                          memory_order_relaxed);
+    return now;
+}
+
+static void* search_worker_init(void *user_data) {
+    search_context_t *ctx = (search_context_t*)user_data;
+
+    search_worker_t *worker = malloc(sizeof(search_worker_t));
+    if (!worker) return NULL;
+
+    if (!platform_name_arena_init(&worker->names, SEARCH_NAME_ARENA_SIZE)) {
+        free(worker);
+        return NULL;
+    }
+    worker->io = NULL;
+    if (ctx && ctx->criteria->use_io_uring) {
+        worker->io = platform_io_engine_create(SEARCH_DIR_BATCH_SIZE);
+    }
+    worker->path = NULL;
+    worker->path_capacity = 0;
+    worker->inline_count = 0;
+    worker->chunk = NULL;
+    worker->published = 0;
+    worker->retaining = true;
+    worker->sort = ctx ? ctx->criteria->sort : SEARCH_SORT_NONE;
+    worker->top = NULL;
+    worker->top_pending = 0;
+    for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+        atomic_init(&worker->phase_ns[i], 0);
+    }
+    worker->time_phases = ctx && ctx->criteria->time_phases;
+    worker->ctx = ctx;
+    worker->next = NULL;
+    if (ctx) {
+        platform_mutex_lock(&ctx->workers_lock);
+        worker->next = ctx->workers;
+        ctx->workers = worker;
+        platform_mutex_unlock(&ctx->workers_lock);
+    }
+    return worker;
+}
+
+static void search_retire_top(search_context_t *ctx, search_worker_t *worker) {
+    if (!worker->top) return;
+
+    platform_mutex_lock(&ctx->workers_lock);
+    if (!search_top_merge(ctx->top, worker->top)) {
+        ctx->top_failed = true;
+    }
+    platform_mutex_unlock(&ctx->workers_lock);
+}
+
+static void search_worker_cleanup(void *worker_context, void *user_data) {
+    (void)user_data;
+
+    search_worker_t *worker = (search_worker_t*)worker_context;
+    if (!worker) return;
+
+    search_context_t *ctx = worker->ctx;
+    if (ctx) {
+        platform_mutex_lock(&ctx->workers_lock);
+        search_worker_t **link = &ctx->workers;
+        while (*link != worker) {
+            link = &(*link)->next;
+        }
+        *link = worker->next;
+        for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+            ctx->retired_phase_ns[i] += atomic_load_explicit(&worker->phase_ns[i], memory_order_relaxed);
+        }
+        platform_mutex_unlock(&ctx->workers_lock);
+        search_retire_top(ctx, worker);
+    }
+    search_top_destroy(worker->top);
+
+    // Sorting here spreads the chunk sorts over the workers; the merge at
+    // the end of the search only interleaves them
+    if (worker->retaining) {
+        search_result_chunk_sort(worker->chunk, worker->sort);
+    } else {
+        search_result_chunk_destroy(worker->chunk);
+    }
+    platform_io_engine_destroy(worker->io);
+    platform_name_arena_destroy(&worker->names);
+    free(worker->path);
+    free(worker);
+}
+
+static bool is_path_separator(char c) {
+#ifdef _WIN32
+    return c == '\\' || c == '/';
+#else
+    return c == '/';
+#endif
+}
+
+// Only a root like "C:\\" or "/" already ends in a separator
+static size_t directory_join_len(const directory_work_t *dir) {
+    return (dir->name_len > 0 && is_path_separator(dir->name[dir->name_len - 1])) ? 0 : 1;
+}
+
+static directory_work_t* directory_work_create(search_context_t *ctx, directory_work_t *parent,
+                                               const char *name, size_t depth) {
+    size_t name_len = strlen(name);
+    // Small and short-lived: recycled through the pool's per-worker slabs
+    directory_work_t *work = thread_pool_alloc_object(ctx->thread_pool,
+                                                      sizeof(directory_work_t) + name_len + 1);
+    if (!work) return NULL;
+
+    work->ctx = ctx;
+    work->parent = parent;
+    atomic_init(&work->refs, 1);
+    work->dir = NULL;
+    work->device = parent ? parent->device : 0;
+    work->depth = depth;
+    work->name_len = name_len;
+    work->path_len = parent ? parent->path_len + directory_join_len(parent) + name_len : name_len;
+    memcpy(work->name, name, name_len + 1);
+
+    if (parent) {
+        atomic_fetch_add(&parent->refs, 1);
+    }
+    return work;
+}
+
+static void directory_work_release(directory_work_t *work) {
+    while (work && atomic_fetch_sub(&work->refs, 1) == 1) {
+        directory_work_t *parent = work->parent;
+        thread_pool_free_object(work->ctx->thread_pool, work);
+        work = parent;
+    }
+}
+
+// Build "<dir path>[<sep><name>]" in the worker's path buffer
+static const char* search_build_path(search_worker_t *worker, const directory_work_t *dir, const char *name) {
+    size_t name_len = name ? strlen(name) : 0;
+    size_t total = dir->path_len + (name ? directory_join_len(dir) + name_len : 0);
+
+    if (total + 1 > worker->path_capacity) {
+        size_t capacity = worker->path_capacity ? worker->path_capacity : 256;
+        while (capacity < total + 1) {
+            capacity *= 2;
+        }
+        char *path = realloc(worker->path, capacity);
+        if (!path) return NULL;
+        worker->path = path;
+        worker->path_capacity = capacity;
+    }
+
+    char *end = worker->path + total;
+    *end = '\0';
+    if (name) {
+        end -= name_len;
+        memcpy(end, name, name_len);
+        if (directory_join_len(dir)) {
+            *--end = PLATFORM_PATH_SEP;
+        }
+    }
+    for (const directory_work_t *node = dir; node; node = node->parent) {
+        end -= node->name_len;
+        memcpy(end, node->name, node->name_len);
+        if (node->parent && directory_join_len(node->parent)) {
+            *--end = PLATFORM_PATH_SEP;
+        }
+    }
+
+    return worker->path;
+}
+
+// On Linux, system trees (/proc, /sys, ...) are pruned by filesystem type
+// in search_directory, so only the Windows build skips system folders by name
 static const char* skip_directories[] = {
+#ifdef _WIN32
     "$RECYCLE.BIN", "System Volume Information", "Windows", "Program Files",
     "Program Files (x86)", "ProgramData", "Recovery", "Intel", "AMD", "NVIDIA",
+#endif
     "node_modules", ".git", ".svn", "__pycache__", "obj", "bin", "Debug",
     "Release", ".vs", "packages", "bower_components", "dist", "build"
 };
 
+#ifdef _WIN32
 static bool component_equals(const char *component, const char *name) {
     return _stricmp(component, name) == 0;
 }
 
+static bool is_system_component(const char *component) {
+    return component_equals(component, "$recycle.bin") ||
+           component_equals(component, "system volume information") ||
+           component_equals(component, "program files") ||
+           component_equals(component, "program files (x86)") ||
+           component_equals(component, "programdata") ||
+           component_equals(component, "recovery") ||
+           component_equals(component, "intel") ||
+           component_equals(component, "amd") ||
+           component_equals(component, "nvidia") ||
+           component_equals(component, "hiberfil.sys") ||
+           component_equals(component, "pagefile.sys") ||
+           component_equals(component, "swapfile.sys");
+}
+
+// A directory whose parent already passed is_system_directory is a system
+// directory exactly when its own name is one (or is "windows")
+static bool is_system_child(const char *name) {
+    return component_equals(name, "windows") || is_system_component(name);
+}
+
+// Full-path check, used for the root
 static bool is_system_directory(const char *path) {
     if (!path) return false;
 
@@ -67,18 +330,7 @@ static bool is_system_directory(const char *path) {
                 saw_windows = false;
             }
 
-            if (component_equals(component, "$recycle.bin") ||
-                component_equals(component, "system volume information") ||
-                component_equals(component, "program files") ||
-                component_equals(component, "program files (x86)") ||
-                component_equals(component, "programdata") ||
-                component_equals(component, "recovery") ||
-                component_equals(component, "intel") ||
-                component_equals(component, "amd") ||
-                component_equals(component, "nvidia") ||
-                component_equals(component, "hiberfil.sys") ||
-                component_equals(component, "pagefile.sys") ||
-                component_equals(component, "swapfile.sys")) {
+            if (is_system_component(component)) {
                 return true;
             }
         }
@@ -90,6 +342,19 @@ static bool is_system_directory(const char *path) {
 
     return saw_windows; // unlikely, but if path ends with "windows" treat as system
 }
+#else
+// Windows system folders have no counterpart elsewhere; a Linux directory
+// named "amd" or "windows" is ordinary data
+static bool is_system_child(const char *name) {
+    (void)name;
+    return false;
+}
+
+static bool is_system_directory(const char *path) {
+    (void)path;
+    return false;
+}
+#endif
 
 static bool should_skip_directory(const char *dirname, const search_criteria_t *criteria) {
     if (!dirname || !criteria || !criteria->skip_common_dirs) return false;
@@ -100,79 +365,129 @@ static bool should_skip_directory(const char *dirname, const search_criteria_t *
     return false;
 }
 
-search_result_t* create_search_result(const char *path, bool is_directory, uint64_t size, FILETIME mtime) {
-    if (!path) return NULL;
+// Hand the worker's unpublished records to the callback, outside any
+// shared lock. They already sit in the result set, in this worker's chunk.
+static void search_publish_results(search_context_t *ctx, search_worker_t *worker) {
+    // --top publishes nothing until the end, but its matches count now
+    if (worker->top_pending > 0) {
+        atomic_fetch_add(&ctx->total_results, worker->top_pending);
+        worker->top_pending = 0;
+    }
+    if (!worker->chunk) return;
 
-    search_result_t *result = malloc(sizeof(search_result_t));
-    if (!result) return NULL;
+    size_t count = search_result_chunk_count(worker->chunk) - worker->published;
+    if (count == 0) return;
 
-    result->path = _strdup(path);
-    if (!result->path) {
-        free(result);
-        return NULL;
+    const search_result_t *first = search_result_chunk_records(worker->chunk) + worker->published;
+    worker->published += count;
+
+    if (ctx->result_callback && !ctx->result_callback(first, count, ctx->result_user_data)) {
+        atomic_store(&ctx->should_stop, true);
+    }
+    if (!worker->retaining) {
+        search_result_chunk_reset(worker->chunk);
+        worker->published = 0;
+    }
+
+    // With a limit, results were counted as they were reserved
+    if (ctx->criteria->max_results == 0) {
+        atomic_fetch_add(&ctx->total_results, count);
     }
-    for (char *p = result->path; *p; ++p) {
-        if (*p == '/') {
-            *p = '\\';
+}
+
+static bool search_store_result(search_context_t *ctx, search_worker_t *worker, const char *path,
+                                bool is_directory, uint64_t size, FILETIME mtime) {
+    size_t path_len = strlen(path);
+    if (search_result_chunk_append(worker->chunk, path, path_len, is_directory, size, mtime)) {
+        return true;
+    }
+
+    // Chunk full: publish what is left of it and continue in a new one
+    search_publish_results(ctx, worker);
+    search_result_chunk_t *chunk;
+    if (ctx->results) {
+        search_result_chunk_sort(worker->chunk, ctx->criteria->sort);
+        chunk = search_results_add_chunk(ctx->results, path_len);
+    } else {
+        // Streaming: the emptied chunk only needs replacing for a longer path
+        if (worker->chunk && search_result_chunk_append(worker->chunk, path, path_len, is_directory, size, mtime)) {
+            return true;
+        }
+        chunk = search_result_chunk_create(path_len);
+        if (chunk && worker->chunk && !worker->retaining) {
+            search_result_chunk_destroy(worker->chunk);
         }
     }
+    if (!chunk) return false;
+    worker->chunk = chunk;
+    worker->published = 0;
+    worker->retaining = ctx->results != NULL;
+    return search_result_chunk_append(chunk, path, path_len, is_directory, size, mtime) != NULL;
+}
 
-    result->is_directory = is_directory;
-    result->size = size;
-    result->mtime = mtime;
-    result->next = NULL;
+// --max-results caps what --top keeps, never what it ranks: the crawl
+// runs to the end and the limit only shrinks the heaps
+static size_t search_top_capacity(const search_criteria_t *criteria) {
+    size_t max_results = criteria->max_results;
+    return max_results > 0 && max_results < criteria->top_count ? max_results : criteria->top_count;
+}
 
-    return result;
+// --top: rank against this worker's own heap, without any shared state
+static bool search_offer_top(search_context_t *ctx, search_worker_t *worker, const char *path,
+                             bool is_directory, uint64_t size, FILETIME mtime) {
+    if (!worker->top) {
+        worker->top = search_top_create(search_top_capacity(ctx->criteria), ctx->criteria->top_by);
+        if (!worker->top) return false;
+    }
+    if (!search_top_offer(worker->top, path, strlen(path), is_directory, size, mtime)) {
+        return false;
+    }
+    worker->top_pending++;
+    return true;
 }
 
-static bool add_result_safe(search_context_t *ctx, const char *path, bool is_directory, uint64_t size, FILETIME mtime) {
+static bool add_result(search_context_t *ctx, search_worker_t *worker, const char *path,
+                       bool is_directory, uint64_t size, FILETIME mtime) {
     if (!ctx || !path) return false;
 
     if (atomic_load(&ctx->should_stop)) {
         return false;
     }
 
-    if (ctx->criteria->max_results > 0 &&
-        atomic_load(&ctx->total_results) >= ctx->criteria->max_results) {
+    if (ctx->top) {
+        return search_offer_top(ctx, worker, path, is_directory, size, mtime);
+    }
+
+    // Reserve a slot first, so concurrent workers never overshoot the limit
+    size_t max_results = ctx->criteria->max_results;
+    if (max_results > 0 && atomic_fetch_add(&ctx->total_results, 1) >= max_results) {
+        atomic_fetch_sub(&ctx->total_results, 1);
         atomic_store(&ctx->should_stop, true);
         return false;
     }
 
-    search_result_t *result = create_search_result(path, is_directory, size, mtime);
-    if (!result) return false;
-
-    bool continue_search = true;
-    EnterCriticalSection(&ctx->results_lock);
-    if (ctx->result_callback) {
-        continue_search = ctx->result_callback(result, ctx->result_user_data);
-        if (!continue_search) {
-            atomic_store(&ctx->should_stop, true);
+    if (!search_store_result(ctx, worker, path, is_directory, size, mtime)) {
+        if (max_results > 0) {
+            atomic_fetch_sub(&ctx->total_results, 1);
         }
+        return false;
     }
 
-    if (!ctx->results_head) {
-        ctx->results_head = result;
-        ctx->results_tail = result;
-    } else {
-        ctx->results_tail->next = result;
-        ctx->results_tail = result;
+    if (search_result_chunk_count(worker->chunk) - worker->published >= SEARCH_RESULT_PUBLISH) {
+        search_publish_results(ctx, worker);
     }
-    atomic_fetch_add(&ctx->total_results, 1);
-    LeaveCriticalSection(&ctx->results_lock);
 
-    if (ctx->criteria->max_results > 0 &&
-        atomic_load(&ctx->total_results) >= ctx->criteria->max_results) {
+    if (max_results > 0 && atomic_load(&ctx->total_results) >= max_results) {
         atomic_store(&ctx->should_stop, true);
     }
 
-    return continue_search;
+    return true;
 }
 
-static bool matches_file_criteria(const platform_file_info_t *file_info, const search_criteria_t *criteria) {
+// Name-based filters are free, so they run before any metadata is fetched
+static bool matches_file_name_criteria(const platform_dir_entry_t *file_info, const search_criteria_t *criteria) {
     if (!file_info || !criteria) return false;
 
-    if (!criteria_size_matches(file_info->size, criteria)) return false;
-    if (!criteria_time_matches(&file_info->mtime, criteria)) return false;
     if (!criteria_extension_matches(file_info->name, criteria)) return false;
     if (!criteria_file_type_matches(file_info->name, criteria)) return false;
 
@@ -186,11 +501,9 @@ static bool matches_file_criteria(const platform_file_info_t *file_info, const s
     return true;
 }
 
-static bool matches_directory_criteria(const platform_file_info_t *file_info, const search_criteria_t *criteria) {
+static bool matches_directory_name_criteria(const platform_dir_entry_t *file_info, const search_criteria_t *criteria) {
     if (!file_info || !criteria) return false;
 
-    if (!criteria_time_matches(&file_info->mtime, criteria)) return false;
-
     if (criteria->search_term && *criteria->search_term) {
         if (!pattern_matches(file_info->name, criteria->search_term,
                              criteria->case_sensitive, criteria->use_glob, criteria->use_regex)) {
@@ -201,94 +514,364 @@ static bool matches_directory_criteria(const platform_file_info_t *file_info, co
     return true;
 }
 
-static void process_directory_work(void *context, void *user_data) {
-    (void)context;
+// Size/time filters; the fields in ctx->metadata_plan must already be loaded
+static bool matches_metadata_criteria(const platform_dir_entry_t *file_info, const search_criteria_t *criteria) {
+    if (!file_info || !criteria) return false;
 
-    directory_work_t *work = (directory_work_t*)user_data;
-    search_context_t *ctx = work->ctx;
+    if (!file_info->is_directory && !criteria_size_matches(file_info->size, criteria)) return false;
+    if (!criteria_time_matches(&file_info->mtime, criteria)) return false;
 
-    if (atomic_load(&ctx->should_stop)) {
-        goto cleanup;
+    return true;
+}
+
+// Following links turns the tree into a graph; entering every directory
+// at most once breaks cycles and skips subtrees reachable twice
+static bool claim_directory(search_context_t *ctx, platform_dir_iter_t *dir) {
+    if (!ctx->visited_dirs) return true;
+
+    platform_file_id_t id;
+    if (!platform_dir_file_id(dir, &id)) return true;
+    return file_id_set_insert(ctx->visited_dirs, id.device, id.inode);
+}
+
+// Only files with more than one link can repeat, so only they enter the set
+static bool is_first_link(search_context_t *ctx, const platform_dir_entry_t *file_info) {
+    if (!ctx->seen_files || file_info->is_directory || file_info->link_count <= 1) return true;
+    return file_id_set_insert(ctx->seen_files, file_info->id.device, file_info->id.inode);
+}
+
+static void release_dir_handle(search_context_t *ctx, directory_work_t *work) {
+    if (work->dir) {
+        platform_closedir(work->dir);
+        work->dir = NULL;
+        atomic_fetch_sub(&ctx->open_dirs, 1);
     }
+}
 
-    if (is_system_directory(work->directory_path)) {
-        goto cleanup;
+static void process_directory_work(void *context, void *user_data);
+static void process_directory_inline(search_context_t *ctx, directory_work_t *work);
+
+// Keep a subdirectory on this thread rather than queueing it. Only while
+// no worker is idle (so nobody is starved of it) and only on the same
+// device (so it runs under the slot this directory already holds).
+static bool search_keep_inline(search_context_t *ctx, search_worker_t *worker,
+                               const directory_work_t *work, const directory_work_t *child) {
+    // Other orders need every directory in the pool's queue to rank it
+    return ctx->criteria->order == SEARCH_ORDER_DFS &&
+           worker->inline_count < SEARCH_INLINE_STACK_SIZE &&
+           child->device == work->device &&
+           !thread_pool_has_idle_workers(ctx->thread_pool);
+}
+
+static void submit_directory_work(search_context_t *ctx, directory_work_t *work) {
+    // Depth is the priority: shallow-first reads the nearest directories first
+    if (!thread_pool_submit_prioritized(ctx->thread_pool, process_directory_work, work, work->device,
+                                        work->depth > UINT_MAX ? UINT_MAX : (unsigned int)work->depth)) {
+        process_directory_inline(ctx, work);
     }
+}
+
+// Hand everything but the next directory to the pool, oldest (and so
+// usually largest) first, so idle workers have something to steal
+static void search_share_inline(search_context_t *ctx, search_worker_t *worker) {
+    if (worker->inline_count < 2 || !thread_pool_has_idle_workers(ctx->thread_pool)) {
+        return;
+    }
+
+    size_t shared = worker->inline_count - 1;
+    for (size_t i = 0; i < shared; i++) {
+        submit_directory_work(ctx, worker->inline_stack[i]);
+    }
+    worker->inline_stack[0] = worker->inline_stack[shared];
+    worker->inline_count = 1;
+}
+
+// Read one directory: report its matches and queue or stack its subdirectories
+static void search_directory(search_context_t *ctx, search_worker_t *worker, directory_work_t *work) {
+    platform_dir_iter_t *dir_iter = NULL;
 
-    platform_dir_iter_t *dir_iter = platform_opendir(work->directory_path);
-    if (!dir_iter) {
+    if (!worker || atomic_load(&ctx->should_stop)) {
         goto cleanup;
     }
 
-    platform_file_info_t file_info;
-    while (platform_readdir(dir_iter, &file_info)) {
-        if (atomic_load(&ctx->should_stop)) {
-            platform_free_file_info(&file_info);
-            break;
+    if (work->dir) {
+        dir_iter = work->dir;
+    } else {
+        // Root, or a child queued while the handle budget was exhausted
+        const char *dir_path = search_build_path(worker, work, NULL);
+        if (!dir_path || (!work->parent && is_system_directory(dir_path))) {
+            goto cleanup;
         }
-
-        if (!ctx->criteria->include_hidden && file_info.name[0] == '.') {
-            platform_free_file_info(&file_info);
-            continue;
+        uint64_t open_start = search_phase_start(worker);
+        dir_iter = platform_opendir(dir_path);
+        search_phase_end(worker, SEARCH_PHASE_OPEN, open_start);
+        if (!dir_iter) {
+            goto cleanup;
+        }
+        if (!claim_directory(ctx, dir_iter)) {
+            goto cleanup;
         }
+    }
 
-        char full_path[MAX_PATH * 2];
-        int written = snprintf(full_path, sizeof(full_path), "%s\\%s", work->directory_path, file_info.name);
-        if (written < 0 || (size_t)written >= sizeof(full_path)) {
-            platform_free_file_info(&file_info);
-            continue;
+    // Mount boundaries are found by device change, so the filesystem checks
+    // run once per directory and only where a new filesystem starts
+    uint64_t device = platform_dir_device(dir_iter);
+    if (work->parent && device != work->parent->device) {
+        if (ctx->criteria->one_file_system) {
+            goto cleanup;
+        }
+        if (!ctx->criteria->include_pseudo_fs && platform_dir_is_pseudo_fs(dir_iter)) {
+            goto cleanup;
         }
+    }
+    // Children left unopened inherit this; opened ones are tagged exactly
+    work->device = device;
+
+    unsigned metadata_fields = ctx->metadata_plan |
+                               (ctx->criteria->report_metadata ? PLATFORM_METADATA_ALL : 0);
+    bool stopping = false;
+
+    while (!stopping) {
+        uint64_t phase_start = search_phase_start(worker);
+        size_t batch_count = platform_readdir_batch(dir_iter, worker->entries, SEARCH_DIR_BATCH_SIZE,
+                                                    &worker->names, 0);
+        phase_start = search_phase_end(worker, SEARCH_PHASE_READDIR, phase_start);
+        if (batch_count == 0) {
+            break;
+        }
+
+        size_t pending_count = 0;
+        size_t open_count = 0;
+        atomic_fetch_add_explicit(&ctx->scanned_entries, batch_count, memory_order_relaxed);
+
+        // Pass 1: decide everything that needs only the name and entry type
+        for (size_t i = 0; i < batch_count; i++) {
+            platform_dir_entry_t *file_info = &worker->entries[i];
+            worker->actions[i] = 0;
+            worker->child_dirs[i] = NULL;
 
-        if (file_info.is_directory) {
-            if (file_info.is_symlink && !ctx->criteria->follow_symlinks) {
-                platform_free_file_info(&file_info);
+            if (!ctx->criteria->include_hidden && file_info->name[0] == '.') {
                 continue;
             }
 
-            if (!should_skip_directory(file_info.name, ctx->criteria)) {
-                if (ctx->criteria->include_directories && matches_directory_criteria(&file_info, ctx->criteria)) {
-                    add_result_safe(ctx, full_path, true, 0, file_info.mtime);
+            if (file_info->is_directory) {
+                if (file_info->is_symlink && !ctx->criteria->follow_symlinks) {
+                    continue;
+                }
+                if (should_skip_directory(file_info->name, ctx->criteria)) {
+                    continue;
+                }
+
+                if (ctx->criteria->include_directories && matches_directory_name_criteria(file_info, ctx->criteria)) {
+                    worker->actions[i] |= SEARCH_ENTRY_RESULT;
                 }
 
                 // Check depth limit before recursing into subdirectory
                 // max_depth == 0 means current directory only (no recursion)
                 // work->depth starts at 0, so depth 1+ directories require max_depth >= 1
-                if (work->depth < ctx->criteria->max_depth) {
-                    directory_work_t *subdir_work = malloc(sizeof(directory_work_t));
-                    if (subdir_work) {
-                        subdir_work->ctx = ctx;
-                        subdir_work->directory_path = _strdup(full_path);
-                        subdir_work->depth = work->depth + 1;
-
-                        if (subdir_work->directory_path) {
-                            atomic_fetch_add(&ctx->queued_dirs, 1);
-                            if (!thread_pool_submit(ctx->thread_pool, process_directory_work, subdir_work)) {
-                                process_directory_work(NULL, subdir_work);
-                            }
-                        } else {
-                            free(subdir_work);
-                        }
+                if (work->depth < ctx->criteria->max_depth && !is_system_child(file_info->name)) {
+                    worker->actions[i] |= SEARCH_ENTRY_DESCEND;
+
+                    // Open relative to this directory while it is hot, unless too
+                    // many handles are already parked in the queue
+                    if (atomic_fetch_add(&ctx->open_dirs, 1) < ctx->open_dir_budget) {
+                        worker->child_names[open_count] = file_info->name;
+                        worker->child_slots[open_count] = i;
+                        open_count++;
+                    } else {
+                        atomic_fetch_sub(&ctx->open_dirs, 1);
                     }
                 }
+            } else {
+                if (ctx->criteria->include_files && matches_file_name_criteria(file_info, ctx->criteria)) {
+                    worker->actions[i] |= SEARCH_ENTRY_RESULT;
+                }
+                atomic_fetch_add(&ctx->processed_files, 1);
             }
-        } else {
-            if (ctx->criteria->include_files && matches_file_criteria(&file_info, ctx->criteria)) {
-                add_result_safe(ctx, full_path, false, file_info.size, file_info.mtime);
+
+            if ((worker->actions[i] & SEARCH_ENTRY_RESULT) && metadata_fields) {
+                worker->pending[pending_count++] = file_info;
             }
-            atomic_fetch_add(&ctx->processed_files, 1);
         }
 
-        platform_free_file_info(&file_info);
-    }
+        phase_start = search_phase_end(worker, SEARCH_PHASE_MATCH, phase_start);
+
+        // Pass 2: one batched round of statx/openat for the survivors
+        if (pending_count > 0) {
+            platform_dir_entries_load_metadata(worker->io, dir_iter, worker->pending, pending_count, metadata_fields);
+            phase_start = search_phase_end(worker, SEARCH_PHASE_READDIR, phase_start);
+        }
+        if (open_count > 0) {
+            platform_opendir_at_batch(worker->io, dir_iter, worker->child_names, worker->opened, open_count);
+            phase_start = search_phase_end(worker, SEARCH_PHASE_OPEN, phase_start);
+            for (size_t j = 0; j < open_count; j++) {
+                size_t slot = worker->child_slots[j];
+                worker->child_dirs[slot] = worker->opened[j];
+                if (!worker->opened[j]) {
+                    atomic_fetch_sub(&ctx->open_dirs, 1);
+                    worker->actions[slot] &= (unsigned char)~SEARCH_ENTRY_DESCEND;
+                }
+            }
+        }
+
+        // Pass 3: size/time checks, results, and hand-off of subdirectories
+        for (size_t i = 0; i < batch_count; i++) {
+            platform_dir_entry_t *file_info = &worker->entries[i];
+            unsigned actions = worker->actions[i];
+            platform_dir_iter_t *child_dir = worker->child_dirs[i];
+
+            if (!stopping && atomic_load(&ctx->should_stop)) {
+                stopping = true;
+            }
+            if (stopping) {
+                // Still walk the batch so every opened child gets closed
+                if (child_dir) {
+                    platform_closedir(child_dir);
+                    atomic_fetch_sub(&ctx->open_dirs, 1);
+                }
+                continue;
+            }
 
-    platform_closedir(dir_iter);
+            if ((actions & SEARCH_ENTRY_RESULT) && matches_metadata_criteria(file_info, ctx->criteria) &&
+                is_first_link(ctx, file_info)) {
+                phase_start = search_phase_end(worker, SEARCH_PHASE_MATCH, phase_start);
+                const char *full_path = search_build_path(worker, work, file_info->name);
+                if (full_path) {
+                    add_result(ctx, worker, full_path, file_info->is_directory,
+                               file_info->is_directory ? 0 : file_info->size, file_info->mtime);
+                }
+                phase_start = search_phase_end(worker, SEARCH_PHASE_RESULT, phase_start);
+            }
+
+            if ((actions & SEARCH_ENTRY_DESCEND) && child_dir && !claim_directory(ctx, child_dir)) {
+                platform_closedir(child_dir);
+                atomic_fetch_sub(&ctx->open_dirs, 1);
+                continue;
+            }
+
+            if (actions & SEARCH_ENTRY_DESCEND) {
+                directory_work_t *subdir_work = directory_work_create(ctx, work, file_info->name, work->depth + 1);
+                if (!subdir_work) {
+                    if (child_dir) {
+                        platform_closedir(child_dir);
+                        atomic_fetch_sub(&ctx->open_dirs, 1);
+                    }
+                    continue;
+                }
+                subdir_work->dir = child_dir;
+                if (child_dir) {
+                    subdir_work->device = platform_dir_device(child_dir);
+                }
+
+                atomic_fetch_add(&ctx->queued_dirs, 1);
+                if (search_keep_inline(ctx, worker, work, subdir_work)) {
+                    worker->inline_stack[worker->inline_count++] = subdir_work;
+                } else {
+                    submit_directory_work(ctx, subdir_work);
+                }
+            }
+        }
+        search_phase_end(worker, SEARCH_PHASE_MATCH, phase_start);
+    }
 
 cleanup:
-    free(work->directory_path);
-    free(work);
+    if (work->dir) {
+        release_dir_handle(ctx, work);
+    } else if (dir_iter) {
+        platform_closedir(dir_iter);
+    }
+    directory_work_release(work);
+    atomic_fetch_sub(&ctx->queued_dirs, 1);
+}
+
+// A directory still queued when the pool stops: close the handle it may
+// hold and drop it as search_directory would have
+static void discard_directory_work(void *user_data) {
+    directory_work_t *work = (directory_work_t*)user_data;
+    search_context_t *ctx = work->ctx;
+
+    release_dir_handle(ctx, work);
+    directory_work_release(work);
     atomic_fetch_sub(&ctx->queued_dirs, 1);
 }
 
+static void run_directory_work(search_context_t *ctx, search_worker_t *worker, directory_work_t *work) {
+    search_directory(ctx, worker, work);
+
+    // Depth-first through what the directory left on our stack; the
+    // batch scratch space is free again between directories
+    size_t inlined = 0;
+    while (worker && worker->inline_count > 0) {
+        search_share_inline(ctx, worker);
+        search_directory(ctx, worker, worker->inline_stack[--worker->inline_count]);
+        inlined++;
+    }
+    if (inlined > 0) {
+        thread_pool_count_inline(ctx->thread_pool, inlined);
+    }
+    // Nothing stays buffered between work items, so a worker that goes
+    // idle (or a search that ends) has published everything it found
+    if (worker) {
+        search_publish_results(ctx, worker);
+    }
+}
+
+static void process_directory_work(void *context, void *user_data) {
+    directory_work_t *work = (directory_work_t*)user_data;
+    if (!context) {
+        process_directory_inline(work->ctx, work);
+        return;
+    }
+    run_directory_work(work->ctx, (search_worker_t*)context, work);
+}
+
+// A directory the pool would not take runs on the calling thread, whose
+// own worker state (if any) is still busy with the parent
+static void process_directory_inline(search_context_t *ctx, directory_work_t *work) {
+    // The pool refuses work once the search stops; nothing left to read it for
+    if (atomic_load(&ctx->should_stop)) {
+        discard_directory_work(work);
+        return;
+    }
+
+    // One fallback worker serves the search; only a nested or concurrent
+    // fallback pays for temporary state
+    search_worker_t *worker;
+    search_worker_t *owned_worker = NULL;
+    bool claimed = !atomic_exchange(&ctx->fallback_busy, true);
+    if (claimed) {
+        if (!ctx->fallback_worker) {
+            ctx->fallback_worker = search_worker_init(ctx);
+        }
+        worker = ctx->fallback_worker;
+    } else {
+        owned_worker = search_worker_init(NULL);
+        worker = owned_worker;
+    }
+
+    run_directory_work(ctx, worker, work);
+
+    if (claimed) {
+        atomic_store(&ctx->fallback_busy, false);
+    }
+    // An unregistered worker has no ctx to retire its heap into on cleanup
+    if (owned_worker) {
+        search_retire_top(ctx, owned_worker);
+    }
+    search_worker_cleanup(owned_worker, NULL);
+}
+
+static void search_collect_phase_stats(search_context_t *ctx, search_phase_stats_t *stats) {
+    platform_mutex_lock(&ctx->workers_lock);
+    for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+        stats->phase_ns[i] = ctx->retired_phase_ns[i];
+        for (search_worker_t *worker = ctx->workers; worker; worker = worker->next) {
+            stats->phase_ns[i] += atomic_load_explicit(&worker->phase_ns[i], memory_order_relaxed);
+        }
+    }
+    platform_mutex_unlock(&ctx->workers_lock);
+}
+
 static bool search_progress_callback(size_t processed_files, size_t queued_dirs, void *user_data) {
     search_context_t *ctx = (search_context_t*)user_data;
     (void)processed_files;
@@ -296,6 +879,7 @@ static bool search_progress_callback(size_t processed_files, size_t queued_dirs,
 
     if (ctx->thread_pool) {
         thread_pool_get_stats(ctx->thread_pool, &last_thread_stats);
+        search_collect_phase_stats(ctx, &last_phase_stats);
         last_thread_stats_valid = true;
     }
 
@@ -309,8 +893,30 @@ static bool search_progress_callback(size_t processed_files, size_t queued_dirs,
     return !atomic_load(&ctx->should_stop);
 }
 
+// Hand a finished result set to the callback, in its order, from the
+// calling thread; for --top, whose results exist only once workers are done
+static void search_deliver_results(search_context_t *ctx) {
+    if (!ctx->result_callback) return;
+
+    search_result_t batch[SEARCH_RESULT_PUBLISH];
+    size_t count = 0;
+    search_results_iter_t iter;
+    search_results_iter_init(&iter, ctx->results);
+    const search_result_t *result;
+    while ((result = search_results_next(&iter)) != NULL) {
+        batch[count++] = *result;
+        if (count == SEARCH_RESULT_PUBLISH) {
+            if (!ctx->result_callback(batch, count, ctx->result_user_data)) return;
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        ctx->result_callback(batch, count, ctx->result_user_data);
+    }
+}
+
 int search_files_advanced(search_criteria_t *criteria,
-                         search_result_t **results, size_t *count,
+                         search_results_t **results, size_t *count,
                          result_callback_t result_callback, void *result_user_data,
                          search_progress_callback_t progress_callback, void *progress_user_data) {
     if (!criteria || !criteria_validate(criteria)) return -1;
@@ -320,54 +926,94 @@ int search_files_advanced(search_criteria_t *criteria,
 
     search_context_t ctx = {0};
     ctx.criteria = criteria;
+    ctx.metadata_plan = criteria_metadata_plan(criteria);
+    ctx.open_dir_budget = criteria->max_open_dirs > 0 ? criteria->max_open_dirs : platform_dir_handle_budget();
+    atomic_init(&ctx.open_dirs, 0);
     atomic_init(&ctx.total_results, 0);
     atomic_init(&ctx.processed_files, 0);
+    atomic_init(&ctx.scanned_entries, 0);
     atomic_init(&ctx.queued_dirs, 0);
     atomic_init(&ctx.should_stop, false);
-    ctx.results_head = NULL;
-    ctx.results_tail = NULL;
+    atomic_init(&ctx.fallback_busy, false);
+    ctx.visited_dirs = NULL;
+    ctx.seen_files = NULL;
+    // Only a caller that wants the results back gets them kept; a
+    // callback-only search publishes from one reused chunk per worker.
+    // --top always collects its final few into a result set.
+    bool keep_results = results || criteria->top_count > 0;
+    ctx.results = keep_results ? search_results_create() : NULL;
+    ctx.top = criteria->top_count > 0 ? search_top_create(search_top_capacity(criteria), criteria->top_by) : NULL;
     ctx.result_callback = result_callback;
     ctx.result_user_data = result_user_data;
     ctx.progress_callback = progress_callback;
     ctx.progress_user_data = progress_user_data;
 
-    if (!InitializeCriticalSectionAndSpinCount(&ctx.results_lock, 4000)) {
+    if ((keep_results && !ctx.results) || (criteria->top_count > 0 && !ctx.top)) {
+        free_search_results(ctx.results);
+        search_top_destroy(ctx.top);
         return -1;
     }
+    platform_mutex_init(&ctx.workers_lock);
+    ctx.workers = NULL;
 
     thread_pool_config_t pool_config = {0};
     pool_config.max_threads = criteria->max_threads;
     pool_config.progress_cb = search_progress_callback;
     pool_config.progress_user_data = &ctx;
     pool_config.stop_flag = &ctx.should_stop;
+    pool_config.worker_init = search_worker_init;
+    pool_config.worker_cleanup = search_worker_cleanup;
+    pool_config.worker_user_data = &ctx;
+    pool_config.work_release = discard_directory_work;
+    pool_config.per_device_limit = criteria->device_threads;
+    // An explicit --threads is taken as given unless tuning was asked for
+    pool_config.adaptive_threads = criteria->max_threads == 0 || criteria->tune_threads;
+    pool_config.throughput_counter = &ctx.scanned_entries;
+    pool_config.pin_threads = criteria->pin_threads;
+    switch (criteria->order) {
+        case SEARCH_ORDER_BFS:           pool_config.order = THREAD_POOL_ORDER_FIFO; break;
+        case SEARCH_ORDER_SHALLOW_FIRST: pool_config.order = THREAD_POOL_ORDER_PRIORITY; break;
+        default:                         pool_config.order = THREAD_POOL_ORDER_LIFO; break;
+    }
 
     ctx.thread_pool = thread_pool_create(&pool_config);
     if (!ctx.thread_pool) {
-        DeleteCriticalSection(&ctx.results_lock);
+        platform_mutex_destroy(&ctx.workers_lock);
+        free_search_results(ctx.results);
+        search_top_destroy(ctx.top);
         return -1;
     }
 
-    directory_work_t *initial_work = malloc(sizeof(directory_work_t));
-    if (!initial_work) {
+    if (criteria->follow_symlinks) {
+        ctx.visited_dirs = file_id_set_create();
+    }
+    if (criteria->unique_inodes) {
+        ctx.seen_files = file_id_set_create();
+    }
+    if ((criteria->follow_symlinks && !ctx.visited_dirs) || (criteria->unique_inodes && !ctx.seen_files)) {
         thread_pool_destroy(ctx.thread_pool);
-        DeleteCriticalSection(&ctx.results_lock);
+        file_id_set_destroy(ctx.visited_dirs);
+        file_id_set_destroy(ctx.seen_files);
+        platform_mutex_destroy(&ctx.workers_lock);
+        free_search_results(ctx.results);
+        search_top_destroy(ctx.top);
         return -1;
     }
 
-    initial_work->ctx = &ctx;
-    initial_work->directory_path = _strdup(criteria->root_path);
-    initial_work->depth = 0;
-
-    if (!initial_work->directory_path) {
-        free(initial_work);
+    directory_work_t *initial_work = directory_work_create(&ctx, NULL, criteria->root_path, 0);
+    if (!initial_work) {
         thread_pool_destroy(ctx.thread_pool);
-        DeleteCriticalSection(&ctx.results_lock);
+        file_id_set_destroy(ctx.visited_dirs);
+        file_id_set_destroy(ctx.seen_files);
+        platform_mutex_destroy(&ctx.workers_lock);
+        free_search_results(ctx.results);
+        search_top_destroy(ctx.top);
         return -1;
     }
 
     atomic_fetch_add(&ctx.queued_dirs, 1);
     if (!thread_pool_submit(ctx.thread_pool, process_directory_work, initial_work)) {
-        process_directory_work(NULL, initial_work);
+        process_directory_inline(&ctx, initial_work);
     }
 
     bool completed = thread_pool_wait_completion(ctx.thread_pool, criteria->timeout_ms);
@@ -378,16 +1024,40 @@ int search_files_advanced(search_criteria_t *criteria,
 
     last_thread_stats_valid = thread_pool_get_stats(ctx.thread_pool, &last_thread_stats);
 
+    // Joins the workers, which fold their phase times into ctx on the way out
     thread_pool_destroy(ctx.thread_pool);
-    DeleteCriticalSection(&ctx.results_lock);
+    search_worker_cleanup(ctx.fallback_worker, NULL);
+    search_collect_phase_stats(&ctx, &last_phase_stats);
+    file_id_set_destroy(ctx.visited_dirs);
+    file_id_set_destroy(ctx.seen_files);
+    platform_mutex_destroy(&ctx.workers_lock);
+
+    // Every worker has merged its heap by now
+    bool exported = !ctx.top || (!ctx.top_failed && search_top_export(ctx.top, ctx.results));
+    search_top_destroy(ctx.top);
+
+    if (!exported || (ctx.results && !search_results_sort(ctx.results, criteria->sort))) {
+        free_search_results(ctx.results);
+        return -1;
+    }
+    if (criteria->top_count > 0) {
+        search_deliver_results(&ctx);
+    }
 
-    if (results) *results = ctx.results_head;
-    if (count) *count = atomic_load(&ctx.total_results);
+    if (results) {
+        *results = ctx.results;
+        if (count) *count = search_results_count(ctx.results);
+    } else {
+        if (count) {
+            *count = ctx.results ? search_results_count(ctx.results) : atomic_load(&ctx.total_results);
+        }
+        free_search_results(ctx.results);
+    }
 
     return completed ? 0 : -2;
 }
 
-int search_files_fast(search_criteria_t *criteria, search_result_t **results, size_t *count) {
+int search_files_fast(search_criteria_t *criteria, search_results_t **results, size_t *count) {
     return search_files_advanced(criteria, results, count, NULL, NULL, NULL, NULL);
 }
 
@@ -397,19 +1067,18 @@ void search_request_cancellation(search_context_t *ctx) {
     }
 }
 
-void free_search_results(search_result_t *results) {
-    while (results) {
-        search_result_t *next = results->next;
-        free(results->path);
-        free(results);
-        results = next;
+bool get_last_search_thread_stats(thread_pool_stats_t *stats) {
+    if (!stats || !last_thread_stats_valid) {
+        return false;
     }
+    *stats = last_thread_stats;
+    return true;
 }
 
-bool get_last_search_thread_stats(thread_pool_stats_t *stats) {
+bool get_last_search_phase_stats(search_phase_stats_t *stats) {
     if (!stats || !last_thread_stats_valid) {
         return false;
     }
-    *stats = last_thread_stats;
+    *stats = last_phase_stats;
     return true;
 }
@@ -4,36 +4,51 @@
 #include "criteria.h"
 #include "../platform/platform.h"
 #include "pattern.h"
+#include "results.h"
 #include "../platform/thread_pool.h"
-#include <windows.h>
+#include "../platform/threading.h"
+#include "../util/file_id_set.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdatomic.h>
 
-typedef struct search_result search_result_t;
 typedef struct search_context search_context_t;
 
-struct search_result {
-    char *path;
-    bool is_directory;
-    uint64_t size;
-    FILETIME mtime;
-    search_result_t *next;
-};
+// Receives matches in runs of count results (results[0] .. results[count - 1]),
+// in the order one worker found them. Called from worker threads,
+// possibly several at once, without any search lock held. Return false to
+// stop the search.
+typedef bool (*result_callback_t)(const search_result_t *results, size_t count, void *user_data);
+
+// Where directory workers spend their busy time; idle time is the pool's.
+// Only measured with criteria->time_phases.
+typedef enum {
+    SEARCH_PHASE_OPEN,      // opening directories
+    SEARCH_PHASE_READDIR,   // reading entries and fetching their metadata
+    SEARCH_PHASE_MATCH,     // filters and queueing subdirectories
+    SEARCH_PHASE_RESULT,    // building paths, result lock and callback
+    SEARCH_PHASE_COUNT
+} search_phase_t;
 
-typedef bool (*result_callback_t)(const search_result_t *result, void *user_data);
+typedef struct {
+    uint64_t phase_ns[SEARCH_PHASE_COUNT];  // summed over workers
+} search_phase_stats_t;
 
 typedef bool (*search_progress_callback_t)(size_t processed_files, size_t queued_dirs,
                                           size_t total_results, void *user_data);
 
 struct search_context {
     search_criteria_t *criteria;
+    unsigned metadata_plan;     // PLATFORM_METADATA_* fields the filters read
     atomic_size_t total_results;
     atomic_size_t processed_files;
+    atomic_size_t scanned_entries;  // every entry read, for worker-count tuning
     atomic_size_t queued_dirs;
-    search_result_t *results_head;
-    search_result_t *results_tail;
-    CRITICAL_SECTION results_lock;
+    atomic_size_t open_dirs;        // queued directories holding an open handle
+    size_t open_dir_budget;
+    file_id_set_t *visited_dirs;    // only with follow_symlinks: directories entered so far
+    file_id_set_t *seen_files;      // only with unique_inodes: files with several links already reported
+    search_results_t *results;
     atomic_bool should_stop;
 
     result_callback_t result_callback;
@@ -41,21 +56,35 @@ struct search_context {
     search_progress_callback_t progress_callback;
     void *progress_user_data;
 
+    // Live workers, and the phase times of those already gone
+    platform_mutex_t workers_lock;
+    struct search_worker *workers;
+    uint64_t retired_phase_ns[SEARCH_PHASE_COUNT];
+    search_top_t *top;          // --top: exited workers' heaps, merged under workers_lock
+    bool top_failed;            // a merge into top ran out of memory; under workers_lock
+    // Runs directories the pool refused, on whichever thread held them
+    struct search_worker *fallback_worker;
+    atomic_bool fallback_busy;
+
     thread_pool_t *thread_pool;
 };
 
-int search_files_fast(search_criteria_t *criteria, search_result_t **results, size_t *count);
+// Pass results as NULL when the callback consumes everything: nothing is
+// then kept, and memory stays bounded however many results there are.
+// Otherwise release them with free_search_results. With criteria->top_count
+// the callback gets the top results only, in order, once the crawl is done.
+int search_files_fast(search_criteria_t *criteria, search_results_t **results, size_t *count);
 
 int search_files_advanced(search_criteria_t *criteria,
-                         search_result_t **results, size_t *count,
+                         search_results_t **results, size_t *count,
                          result_callback_t result_callback, void *result_user_data,
                          search_progress_callback_t progress_callback, void *progress_user_data);
 
-void free_search_results(search_result_t *results);
-search_result_t* create_search_result(const char *path, bool is_directory, uint64_t size, FILETIME mtime);
 
 void search_request_cancellation(search_context_t *ctx);
 
 bool get_last_search_thread_stats(thread_pool_stats_t *stats);
+// Updated with the thread stats: while a search runs and when it ends
+bool get_last_search_phase_stats(search_phase_stats_t *stats);
 
 #endif
@@ -7,66 +7,45 @@
 #include "core/pattern.h"
 #include "platform/platform.h"
 #include "output/preview.h"
+#include "output/writer.h"
 #include "platform/thread_pool.h"
 #include "cli/version.h"
 #include "regex/re.h"
 #include "regex/regex.h"
-#include <io.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <stdatomic.h>
-#include <windows.h>
+
+#ifdef _WIN32
+#include <io.h>
 #include <shellapi.h>
 
 #ifndef _MSC_VER
 int _fileno(FILE *);
 #endif
+#endif
 
 
 #include <time.h>
 
-#define OUTPUT_BUFFER_SIZE 65536
-static char g_output_buffer[OUTPUT_BUFFER_SIZE];
-static size_t g_output_pos = 0;
-static size_t g_results_since_flush = 0;
-#define FLUSH_THRESHOLD 64
-
-static void output_flush(void) {
-    if (g_output_pos > 0) {
-        fwrite(g_output_buffer, 1, g_output_pos, stdout);
-        g_output_pos = 0;
-    }
-}
-
-static void output_write(const char *str, size_t len) {
-    if (g_output_pos + len > OUTPUT_BUFFER_SIZE) {
-        output_flush();
-    }
-    // If single write is larger than buffer, write directly
-    if (len > OUTPUT_BUFFER_SIZE) {
-        fwrite(str, 1, len, stdout);
-        return;
-    }
-    memcpy(g_output_buffer + g_output_pos, str, len);
-    g_output_pos += len;
-}
-
-static void output_puts(const char *str) {
-    output_write(str, strlen(str));
-}
-
 typedef struct {
     cli_options_t *options;
     search_criteria_t *criteria;
     time_t start_time;
+    time_t last_stats_time;
     int progress_shown;
     size_t last_processed;
     size_t last_results;
     bool use_color;
+    output_writer_t *writer;        // owns stdout for plain listings
+    platform_mutex_t preview_lock;  // previews write straight to stdout, one result at a time
 } streamed_state_t;
 
 static bool enable_vt_mode(void) {
+#ifndef _WIN32
+    return true;
+#else
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     if (hOut == INVALID_HANDLE_VALUE || hOut == NULL) return false;
     DWORD mode = 0;
@@ -76,6 +55,7 @@ static bool enable_vt_mode(void) {
     #endif
     if (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) return true;
     return SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
 }
 
 static bool should_use_color(const cli_options_t *options) {
@@ -92,21 +72,38 @@ static bool should_use_color(const cli_options_t *options) {
     }
 }
 
-static void print_path_colored(const search_result_t *result, bool use_color) {
-    if (!result) return;
+static const char color_reset[] = "\x1b[0m\n";
 
-    if (!use_color) {
-        output_puts(result->path);
-        output_write("\n", 1);
-        return;
-    }
+static const char* path_color(const search_result_t *result) {
+    return result->is_directory ? "\x1b[36m" : "\x1b[32m";
+}
+
+static size_t path_line_length(const search_result_t *result, bool use_color) {
+    if (!use_color) return result->path_len + 1;
+    return strlen(path_color(result)) + result->path_len + sizeof(color_reset) - 1;
+}
+
+// The caller makes room for path_line_length bytes, so a line never spans blocks
+static void print_path_colored(output_block_t *out, const search_result_t *result, bool use_color) {
+    char *dst = out->data + out->len;
 
-    const char *color = result->is_directory ? "\x1b[36m" : "\x1b[32m";
-    output_puts(color);
-    output_puts(result->path);
-    output_puts("\x1b[0m\n");
+    if (use_color) {
+        size_t color_len = strlen(path_color(result));
+        memcpy(dst, path_color(result), color_len);
+        dst += color_len;
+    }
+    memcpy(dst, result->path, result->path_len);
+    dst += result->path_len;
+    if (use_color) {
+        memcpy(dst, color_reset, sizeof(color_reset) - 1);
+        dst += sizeof(color_reset) - 1;
+    } else {
+        *dst++ = '\n';
+    }
+    out->len = (size_t)(dst - out->data);
 }
 
+#ifdef _WIN32
 static char** convert_wargv_to_utf8(int argc, wchar_t *wargv[]) {
     if (argc <= 0) return NULL;
     char **argv = (char**)calloc((size_t)argc, sizeof(char*));
@@ -131,40 +128,114 @@ static void free_utf8_argv(int argc, char **argv) {
     }
     free(argv);
 }
+#endif
 
-static bool streamed_result_callback(const search_result_t *result, void *user_data) {
+static bool streamed_result_callback(const search_result_t *results, size_t count, void *user_data) {
     streamed_state_t *state = (streamed_state_t*)user_data;
-    if (state->options->json_output) {
+    if (state->options->json_output || state->criteria->sort != SEARCH_SORT_NONE) {
         return true;
     }
+
     if (state->criteria->preview_mode) {
         // Preview mode needs immediate output
-        output_flush();
-        print_path_colored(result, state->use_color);
-        output_flush();
-        if (!result->is_directory) {
-            fq_file_type_t type = detect_file_type(result->path);
-            if (type == FQ_FILE_TYPE_TEXT) {
-                preview_text_file(result->path, state->criteria->preview_lines, stdout);
+        platform_mutex_lock(&state->preview_lock);
+        for (size_t i = 0; i < count; i++) {
+            const search_result_t *result = &results[i];
+            if (state->use_color) {
+                fputs(path_color(result), stdout);
+            }
+            fwrite(result->path, 1, result->path_len, stdout);
+            fputs(state->use_color ? color_reset : "\n", stdout);
+            if (!result->is_directory) {
+                fq_file_type_t type = detect_file_type(result->path);
+                if (type == FQ_FILE_TYPE_TEXT) {
+                    preview_text_file(result->path, state->criteria->preview_lines, stdout);
+                } else {
+                    preview_file_summary(result->path, stdout);
+                }
             } else {
-                preview_file_summary(result->path, stdout);
+                fprintf(stdout, "  [Directory]\n");
             }
-        } else {
-            fprintf(stdout, "  [Directory]\n");
+            printf("\n");
+            fflush(stdout);
         }
-        printf("\n");
-        fflush(stdout);
-    } else {
-        print_path_colored(result, state->use_color);
-        g_results_since_flush++;
-        if (g_results_since_flush >= FLUSH_THRESHOLD) {
-            output_flush();
-            g_results_since_flush = 0;
+        platform_mutex_unlock(&state->preview_lock);
+        return true;
+    }
+
+    // Format here and leave the writing to the writer thread, so a slow
+    // reader on stdout holds up this worker only once the ring is full
+    output_writer_t *writer = state->writer;
+    if (output_writer_failed(writer)) {
+        return false;
+    }
+
+    output_block_t *block = NULL;
+    for (size_t i = 0; i < count; i++) {
+        size_t line_len = path_line_length(&results[i], state->use_color);
+        if (!block || block->len + line_len > block->capacity) {
+            if (block) {
+                output_writer_submit(writer, block);
+            }
+            block = output_writer_get_block(writer, line_len);
+            if (!block) return false;
         }
+        print_path_colored(block, &results[i], state->use_color);
+    }
+    if (block) {
+        output_writer_submit(writer, block);
     }
     return true;
 }
 
+static double stats_share(uint64_t part, uint64_t whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+// --stats: worker counts and where the workers' time went, as shares of
+// all busy plus idle time. "other" is busy time outside the named phases.
+static void print_thread_stats(bool final) {
+    thread_pool_stats_t stats;
+    search_phase_stats_t phases;
+    if (!get_last_search_thread_stats(&stats) || !get_last_search_phase_stats(&phases)) {
+        return;
+    }
+
+    static const char *phase_names[SEARCH_PHASE_COUNT] = { "open", "readdir", "match", "result" };
+    uint64_t phase_total = 0;
+    for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+        phase_total += phases.phase_ns[i];
+    }
+    uint64_t other_ns = stats.busy_ns > phase_total ? stats.busy_ns - phase_total : 0;
+    uint64_t total_ns = stats.busy_ns + stats.idle_ns;
+
+    if (!final) {
+        fprintf(stderr, "[stats] workers %zu/%zu, %zu done, %zu queued |",
+                stats.worker_limit, stats.max_workers, stats.completed_work_items, stats.queued_work_items);
+        for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+            fprintf(stderr, " %s %.0f%%", phase_names[i], stats_share(phases.phase_ns[i], total_ns));
+        }
+        fprintf(stderr, " other %.0f%% idle %.0f%%\n",
+                stats_share(other_ns, total_ns), stats_share(stats.idle_ns, total_ns));
+        return;
+    }
+
+    fprintf(stderr, "Workers: %zu of %zu running, %zu NUMA node(s)\n",
+            stats.worker_limit, stats.max_workers, stats.numa_nodes);
+    fprintf(stderr, "Work items: %zu submitted, %zu inline, %zu stolen; %zu parks, %zu wakeups\n",
+            stats.total_submitted, stats.inline_work_items, stats.steals, stats.parks, stats.wakeups);
+    fprintf(stderr, "Allocations: %zu reused, %zu carved, %zu heap; %zu remote frees in %zu batches\n",
+            stats.slab_reused, stats.slab_carved, stats.heap_allocs, stats.remote_frees, stats.remote_batches);
+    fprintf(stderr, "Worker time: %.3f s\n", (double)total_ns / 1e9);
+    for (int i = 0; i < SEARCH_PHASE_COUNT; i++) {
+        fprintf(stderr, "  %-8s %10.3f s %6.1f%%\n", phase_names[i],
+                (double)phases.phase_ns[i] / 1e9, stats_share(phases.phase_ns[i], total_ns));
+    }
+    fprintf(stderr, "  %-8s %10.3f s %6.1f%%\n", "other", (double)other_ns / 1e9, stats_share(other_ns, total_ns));
+    fprintf(stderr, "  %-8s %10.3f s %6.1f%%\n", "idle", (double)stats.idle_ns / 1e9,
+            stats_share(stats.idle_ns, total_ns));
+}
+
 static bool streamed_progress_callback(size_t processed_files, size_t queued_dirs, size_t total_results, void *user_data) {
     (void)queued_dirs;
     streamed_state_t *state = (streamed_state_t*)user_data;
@@ -175,18 +246,28 @@ static bool streamed_progress_callback(size_t processed_files, size_t queued_dir
             state->progress_shown = 1;
         }
     }
+    if (state->options->show_stats && difftime(now, state->last_stats_time) >= 1.0) {
+        print_thread_stats(false);
+        state->last_stats_time = now;
+    }
     state->last_processed = processed_files;
     state->last_results = total_results;
     return true;
 }
 
 int main(int argc, char *argv_placeholder[]) {
-    (void)argc;
     search_criteria_t criteria;
     cli_options_t options = {0};
-    search_result_t *results = NULL;
+    search_results_t *results = NULL;
     size_t result_count = 0;
     int exit_code = 0;
+
+#ifndef _WIN32
+    // POSIX argv is already UTF-8
+    int wargc = argc;
+    char **argv = argv_placeholder;
+#else
+    (void)argc;
     (void)argv_placeholder;
 
     int wargc = 0;
@@ -203,6 +284,7 @@ int main(int argc, char *argv_placeholder[]) {
         LocalFree(wargv);
         return 1;
     }
+#endif
 
     if (parse_command_line(wargc, argv, &criteria, &options) != 0) {
         if (!options.show_help && !options.show_version) {
@@ -240,6 +322,7 @@ int main(int argc, char *argv_placeholder[]) {
     stream_state.options = &options;
     stream_state.criteria = &criteria;
     stream_state.start_time = time(NULL);
+    stream_state.last_stats_time = stream_state.start_time;
     stream_state.progress_shown = 0;
     stream_state.last_processed = 0;
     stream_state.last_results = 0;
@@ -250,13 +333,32 @@ int main(int argc, char *argv_placeholder[]) {
         color_ok = enable_vt_mode();
     }
     stream_state.use_color = color_ok;
+    platform_mutex_init(&stream_state.preview_lock);
+
+    // Sorted output can only start once the search is done
+    bool keep_results = options.json_output || criteria.sort != SEARCH_SORT_NONE;
+    if (!keep_results && !criteria.preview_mode) {
+        stream_state.writer = output_writer_create(stdout);
+        if (!stream_state.writer) {
+            fprintf(stderr, "Error: Failed to start output writer\n");
+            platform_mutex_destroy(&stream_state.preview_lock);
+            exit_code = 1;
+            goto cleanup;
+        }
+    }
 
-    int search_result = search_files_advanced(&criteria, &results, &result_count,
+    // Text output streams from the callback; only JSON and sorting need the results kept
+    int search_result = search_files_advanced(&criteria, keep_results ? &results : NULL, &result_count,
         streamed_result_callback, &stream_state,
         streamed_progress_callback, &stream_state);
 
-    // Final flush of any remaining buffered output
-    output_flush();
+    bool output_ok = output_writer_destroy(stream_state.writer);
+    platform_mutex_destroy(&stream_state.preview_lock);
+    fflush(stdout);
+
+    if (options.show_stats) {
+        print_thread_stats(true);
+    }
 
     if (search_result == -2) {
         fprintf(stderr,
@@ -268,7 +370,13 @@ int main(int argc, char *argv_placeholder[]) {
         goto cleanup;
     }
 
-    if (options.json_output) {
+    if (!output_ok) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        exit_code = 1;
+        goto cleanup;
+    }
+
+    if (keep_results) {
         if (output_results(results, result_count, &options, &criteria) != 0) {
             fprintf(stderr, "Error: Failed to output results\n");
             exit_code = 1;
@@ -280,7 +388,9 @@ int main(int argc, char *argv_placeholder[]) {
 cleanup:
     free_search_results(results);
     criteria_cleanup(&criteria);
+#ifdef _WIN32
     free_utf8_argv(wargc, argv);
     LocalFree(wargv);
+#endif
     return exit_code;
 }
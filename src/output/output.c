@@ -33,16 +33,23 @@ static void json_escape_string(FILE *fp, const char *str) {
     fputc('"', fp);
 }
 
-static void output_json_format(FILE *fp, const search_result_t *results, size_t count) {
+static void output_json_format(FILE *fp, const search_results_t *results, size_t count) {
     fputs("{\n", fp);
     fputs("  \"type\": \"search\",\n", fp);
     fprintf(fp, "  \"version\": \"%s\",\n", FQ_VERSION_STRING);
     fprintf(fp, "  \"count\": %zu,\n", count);
     fputs("  \"results\": [\n", fp);
 
-    const search_result_t *current = results;
+    search_results_iter_t iter;
+    search_results_iter_init(&iter, results);
+    const search_result_t *current;
+    bool first = true;
 
-    while (current) {
+    while ((current = search_results_next(&iter)) != NULL) {
+        if (!first) {
+            fputs(",\n", fp);
+        }
+        first = false;
         fputs("    {\n", fp);
 
         fputs("      \"path\": ", fp);
@@ -59,31 +66,29 @@ static void output_json_format(FILE *fp, const search_result_t *results, size_t
         fputs("\n", fp);
 
         fputs("    }", fp);
-        if (current->next) {
-            fputs(",", fp);
-        }
+    }
+    if (!first) {
         fputs("\n", fp);
-
-        current = current->next;
     }
 
     fputs("  ]\n", fp);
     fputs("}\n", fp);
 }
 
-static void output_text_format(FILE *fp, const search_result_t *results, size_t count) {
+static void output_text_format(FILE *fp, const search_results_t *results, size_t count) {
     (void)count;
-    const search_result_t *current = results;
+    search_results_iter_t iter;
+    search_results_iter_init(&iter, results);
+    const search_result_t *current;
 
-    while (current) {
-        fputs(current->path, fp);
+    while ((current = search_results_next(&iter)) != NULL) {
+        fwrite(current->path, 1, current->path_len, fp);
         fputc('\n', fp);
-        current = current->next;
     }
 
 }
 
-int output_search_results(FILE *fp, const search_result_t *results, size_t count, output_format_t format) {
+int output_search_results(FILE *fp, const search_results_t *results, size_t count, output_format_t format) {
     if (!fp) return -1;
 
     switch (format) {
@@ -99,11 +104,13 @@ int output_search_results(FILE *fp, const search_result_t *results, size_t count
     return 0;
 }
 
-static void output_text_format_with_preview(FILE *fp, const search_result_t *results, size_t count, const search_criteria_t *criteria) {
+static void output_text_format_with_preview(FILE *fp, const search_results_t *results, size_t count, const search_criteria_t *criteria) {
     (void)count;
-    const search_result_t *current = results;
+    search_results_iter_t iter;
+    search_results_iter_init(&iter, results);
+    const search_result_t *current;
 
-    while (current) {
+    while ((current = search_results_next(&iter)) != NULL) {
         fputs(current->path, fp);
         fputc('\n', fp);
 
@@ -120,13 +127,11 @@ static void output_text_format_with_preview(FILE *fp, const search_result_t *res
             }
             fputc('\n', fp);
         }
-
-        current = current->next;
     }
 
 }
 
-int output_search_results_with_preview(FILE *fp, const search_result_t *results, size_t count,
+int output_search_results_with_preview(FILE *fp, const search_results_t *results, size_t count,
                                        const search_criteria_t *criteria, output_format_t format) {
     if (!fp) return -1;
 
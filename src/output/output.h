@@ -10,9 +10,9 @@ typedef enum {
     OUTPUT_FORMAT_JSON
 } output_format_t;
 
-int output_search_results(FILE *fp, const search_result_t *results, size_t count, output_format_t format);
+int output_search_results(FILE *fp, const search_results_t *results, size_t count, output_format_t format);
 
-int output_search_results_with_preview(FILE *fp, const search_result_t *results, size_t count,
+int output_search_results_with_preview(FILE *fp, const search_results_t *results, size_t count,
                                        const search_criteria_t *criteria, output_format_t format);
 
 #endif
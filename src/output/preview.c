@@ -5,7 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <windows.h>
+#include <inttypes.h>
 
 fq_file_type_t detect_file_type(const char *filepath) {
     if (!filepath) return FQ_FILE_TYPE_UNKNOWN;
@@ -123,31 +123,21 @@ int preview_text_file(const char *filepath, size_t max_lines, FILE *output) {
 int preview_file_summary(const char *filepath, FILE *output) {
     fq_file_type_t type = detect_file_type(filepath);
 
-    HANDLE hFile = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL,
-                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile == INVALID_HANDLE_VALUE) {
+    uint64_t file_size;
+    if (!platform_get_file_size(filepath, &file_size)) {
         fprintf(output, "  [Error: Cannot access file]\n");
         return -1;
     }
 
-    LARGE_INTEGER fileSize;
-    if (!GetFileSizeEx(hFile, &fileSize)) {
-        CloseHandle(hFile);
-        fprintf(output, "  [Error: Cannot get file size]\n");
-        return -1;
-    }
-
-    CloseHandle(hFile);
-
     char size_str[64];
-    if (fileSize.QuadPart < 1024) {
-        snprintf(size_str, sizeof(size_str), "%I64d bytes", fileSize.QuadPart);
-    } else if (fileSize.QuadPart < 1024 * 1024) {
-        snprintf(size_str, sizeof(size_str), "%.1f KB", fileSize.QuadPart / 1024.0);
-    } else if (fileSize.QuadPart < 1024 * 1024 * 1024) {
-        snprintf(size_str, sizeof(size_str), "%.1f MB", fileSize.QuadPart / (1024.0 * 1024.0));
+    if (file_size < 1024) {
+        snprintf(size_str, sizeof(size_str), "%" PRIu64 " bytes", file_size);
+    } else if (file_size < 1024 * 1024) {
+        snprintf(size_str, sizeof(size_str), "%.1f KB", file_size / 1024.0);
+    } else if (file_size < 1024 * 1024 * 1024) {
+        snprintf(size_str, sizeof(size_str), "%.1f MB", file_size / (1024.0 * 1024.0));
     } else {
-        snprintf(size_str, sizeof(size_str), "%.1f GB", fileSize.QuadPart / (1024.0 * 1024.0 * 1024.0));
+        snprintf(size_str, sizeof(size_str), "%.1f GB", file_size / (1024.0 * 1024.0 * 1024.0));
     }
 
     fprintf(output, "  Type: %s, Size: %s\n", file_type_to_string(type), size_str);
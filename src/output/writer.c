@@ -0,0 +1,282 @@
+#include "writer.h"
+#include "../platform/threading.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#define OUTPUT_BLOCK_SIZE (32 * 1024)
+#define OUTPUT_RING_SLOTS 64            // power of two; bounds what is in flight
+#define OUTPUT_WRITER_BATCH 64          // blocks per vectored write
+
+// Bounded ring after Vyukov: each cell's sequence says whose turn it is, so
+// producers claim slots with one CAS and never wait on each other. The
+// submit ring has one consumer; the free ring has one producer.
+typedef struct {
+    atomic_size_t sequence;
+    output_block_t *block;
+} output_ring_cell_t;
+
+typedef struct {
+    output_ring_cell_t *cells;
+    size_t mask;
+    char pad0[64];
+    atomic_size_t enqueue_pos;
+    char pad1[64];
+    atomic_size_t dequeue_pos;
+    char pad2[64];
+} output_ring_t;
+
+struct output_writer {
+    FILE *stream;
+    platform_thread_t thread;
+    output_ring_t queue;                // submitted blocks
+    output_ring_t spare;                // written blocks ready for reuse
+    platform_event_t data_ready;        // reset by the writer only
+    atomic_uint space_generation;       // bumped when a full ring drains
+    atomic_uint space_waiters;
+    atomic_bool closing;
+    atomic_bool failed;
+};
+
+static bool output_ring_init(output_ring_t *ring, size_t slots) {
+    ring->cells = (output_ring_cell_t*)malloc(slots * sizeof(output_ring_cell_t));
+    if (!ring->cells) return false;
+
+    for (size_t i = 0; i < slots; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+        ring->cells[i].block = NULL;
+    }
+    ring->mask = slots - 1;
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    return true;
+}
+
+static bool output_ring_push(output_ring_t *ring, output_block_t *block) {
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        output_ring_cell_t *cell = &ring->cells[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->block = block;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;   // full
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static output_block_t* output_ring_pop(output_ring_t *ring) {
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        output_ring_cell_t *cell = &ring->cells[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                output_block_t *block = cell->block;
+                atomic_store_explicit(&cell->sequence, pos + ring->mask + 1, memory_order_release);
+                return block;
+            }
+        } else if (diff < 0) {
+            return NULL;    // empty
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static void output_writer_recycle(output_writer_t *writer, output_block_t *block) {
+    // Oversized blocks were made for one long line; don't keep them around
+    if (block->capacity != OUTPUT_BLOCK_SIZE || !output_ring_push(&writer->spare, block)) {
+        free(block);
+    }
+}
+
+#ifdef _WIN32
+
+// Pipes and consoles have no gather write, so let the CRT batch the blocks
+static bool output_writer_write(output_writer_t *writer, output_block_t **blocks, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (fwrite(blocks[i]->data, 1, blocks[i]->len, writer->stream) != blocks[i]->len) {
+            return false;
+        }
+    }
+    return fflush(writer->stream) == 0;
+}
+
+#else
+
+static bool output_writer_write(output_writer_t *writer, output_block_t **blocks, size_t count) {
+    struct iovec iov[OUTPUT_WRITER_BATCH];
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = blocks[i]->data;
+        iov[i].iov_len = blocks[i]->len;
+    }
+
+    int fd = fileno(writer->stream);
+    struct iovec *next = iov;
+    int left = (int)count;
+    while (left > 0) {
+        ssize_t written = writev(fd, next, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        // Skip what went out; a short write leaves the rest of one block
+        size_t done = (size_t)written;
+        while (left > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            next++;
+            left--;
+        }
+        if (left > 0) {
+            next->iov_base = (char*)next->iov_base + done;
+            next->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+#endif
+
+static void output_writer_thread(void *arg) {
+    output_writer_t *writer = (output_writer_t*)arg;
+    output_block_t *batch[OUTPUT_WRITER_BATCH];
+
+    for (;;) {
+        size_t count = 0;
+        while (count < OUTPUT_WRITER_BATCH && (batch[count] = output_ring_pop(&writer->queue)) != NULL) {
+            count++;
+        }
+
+        if (count == 0) {
+            if (atomic_load(&writer->closing)) {
+                // Producers finish before closing is set, so one more look settles it
+                if ((batch[0] = output_ring_pop(&writer->queue)) == NULL) break;
+            } else {
+                // Reset before the last look, so a submit after it sets the event again
+                platform_event_reset(&writer->data_ready);
+                if ((batch[0] = output_ring_pop(&writer->queue)) == NULL) {
+                    if (!atomic_load(&writer->closing)) {
+                        platform_event_wait(&writer->data_ready, PLATFORM_WAIT_INFINITE);
+                    }
+                    continue;
+                }
+            }
+            count = 1;
+        }
+
+        // Wake submitters that found the ring full; the fence orders the
+        // pops above before the waiter check, pairing with the one in submit
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&writer->space_waiters) > 0) {
+            atomic_fetch_add(&writer->space_generation, 1);
+            platform_wake_address_all(&writer->space_generation);
+        }
+
+        if (!atomic_load_explicit(&writer->failed, memory_order_relaxed) &&
+            !output_writer_write(writer, batch, count)) {
+            atomic_store(&writer->failed, true);
+        }
+        for (size_t i = 0; i < count; i++) {
+            output_writer_recycle(writer, batch[i]);
+        }
+    }
+}
+
+output_writer_t* output_writer_create(FILE *stream) {
+    output_writer_t *writer = (output_writer_t*)calloc(1, sizeof(output_writer_t));
+    if (!writer) return NULL;
+
+    writer->stream = stream;
+    platform_event_init(&writer->data_ready, false);
+    atomic_init(&writer->space_generation, 0);
+    atomic_init(&writer->space_waiters, 0);
+    atomic_init(&writer->closing, false);
+    atomic_init(&writer->failed, false);
+
+    if (!output_ring_init(&writer->queue, OUTPUT_RING_SLOTS)) goto fail;
+    if (!output_ring_init(&writer->spare, OUTPUT_RING_SLOTS)) goto fail;
+
+    fflush(stream);
+    if (!platform_thread_create(&writer->thread, output_writer_thread, writer)) goto fail;
+    return writer;
+
+fail:
+    free(writer->queue.cells);
+    free(writer->spare.cells);
+    free(writer);
+    return NULL;
+}
+
+output_block_t* output_writer_get_block(output_writer_t *writer, size_t min_capacity) {
+    output_block_t *block = NULL;
+    if (min_capacity <= OUTPUT_BLOCK_SIZE) {
+        block = output_ring_pop(&writer->spare);
+        min_capacity = OUTPUT_BLOCK_SIZE;
+    }
+    if (!block) {
+        block = (output_block_t*)malloc(sizeof(output_block_t) + min_capacity);
+        if (!block) return NULL;
+        block->capacity = min_capacity;
+    }
+    block->len = 0;
+    return block;
+}
+
+void output_writer_submit(output_writer_t *writer, output_block_t *block) {
+    if (block->len == 0) {
+        output_writer_recycle(writer, block);
+        return;
+    }
+
+    if (!output_ring_push(&writer->queue, block)) {
+        // The writer is behind: wait for it rather than buffer without bound
+        atomic_fetch_add(&writer->space_waiters, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        for (;;) {
+            unsigned int generation = atomic_load(&writer->space_generation);
+            if (output_ring_push(&writer->queue, block)) break;
+            platform_wait_on_address(&writer->space_generation, generation, PLATFORM_WAIT_INFINITE);
+        }
+        atomic_fetch_sub(&writer->space_waiters, 1);
+    }
+    platform_event_set(&writer->data_ready);
+}
+
+bool output_writer_failed(output_writer_t *writer) {
+    return atomic_load_explicit(&writer->failed, memory_order_relaxed);
+}
+
+bool output_writer_destroy(output_writer_t *writer) {
+    if (!writer) return true;
+
+    atomic_store(&writer->closing, true);
+    platform_event_set(&writer->data_ready);
+    platform_thread_join(writer->thread);
+
+    output_block_t *block;
+    while ((block = output_ring_pop(&writer->spare)) != NULL) {
+        free(block);
+    }
+    free(writer->queue.cells);
+    free(writer->spare.cells);
+
+    bool ok = !atomic_load(&writer->failed);
+    free(writer);
+    return ok;
+}
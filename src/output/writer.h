@@ -0,0 +1,38 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// One thread that owns an output stream. Producers format into blocks and
+// submit them through a bounded lock-free ring; the writer drains the ring
+// in batches with one vectored write each. A full ring makes submitters
+// wait, so a slow consumer throttles producers instead of growing memory.
+typedef struct output_writer output_writer_t;
+
+typedef struct output_block {
+    size_t len;
+    size_t capacity;
+    char data[];
+} output_block_t;
+
+// Flushes stream, which must not be written through stdio again until
+// output_writer_destroy returns
+output_writer_t* output_writer_create(FILE *stream);
+
+// An empty block with room for at least min_capacity bytes; NULL if out of memory
+output_block_t* output_writer_get_block(output_writer_t *writer, size_t min_capacity);
+
+// Hands block to the writer, waiting while the ring is full. Empty blocks
+// are recycled without a write.
+void output_writer_submit(output_writer_t *writer, output_block_t *block);
+
+// Set once a write has failed; later blocks are dropped
+bool output_writer_failed(output_writer_t *writer);
+
+// Writes everything submitted, stops the thread; false if any write failed.
+// Producers must be done.
+bool output_writer_destroy(output_writer_t *writer);
+
+#endif
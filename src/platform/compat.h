@@ -27,7 +27,9 @@
         #define inline __inline
     #endif
 
-    // Atomic operations - try C++, then C11, fallback to Interlocked
+    // Atomic operations: C++ or C11. The thread pool, slab caches and output
+    // writer need the whole of <stdatomic.h> (explicit orders, fences,
+    // _Atomic pointers), which has no Interlocked stand-in here.
     #if defined(__cplusplus)
         #include <atomic>
         template<class T> using compat_atomic = std::atomic<T>;
@@ -37,86 +39,10 @@
         #define atomic_store(p, v) ((p)->store((v)))
         #define atomic_fetch_add(p, v) ((p)->fetch_add((v)))
         #define atomic_compare_exchange_strong(p, e, d) ((p)->compare_exchange_strong(*(e),(d)))
-    #elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
-        #ifdef __has_include
-            #if __has_include(<stdatomic.h>) && _MSC_VER >= 1935
-                #include <stdatomic.h>
-            #else
-                #define COMPAT_USE_INTERLOCKED
-            #endif
-        #else
-            #define COMPAT_USE_INTERLOCKED
-        #endif
+    #elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && _MSC_VER >= 1935
+        #include <stdatomic.h>
     #else
-        #define COMPAT_USE_INTERLOCKED
-    #endif
-
-    #ifdef COMPAT_USE_INTERLOCKED
-        typedef volatile LONG atomic_bool;
-
-        #ifdef _WIN64
-            typedef volatile LONG64 atomic_size_t;
-
-            static inline LONG64 compat_atomic_load64(volatile LONG64* p) {
-                return InterlockedOr64((volatile LONG64*)p, 0);
-            }
-
-            static inline void compat_atomic_store64(volatile LONG64* p, LONG64 v) {
-                InterlockedExchange64((volatile LONG64*)p, v);
-            }
-
-            static inline int compat_cas64(volatile LONG64* p, LONG64* expected, LONG64 desired) {
-                LONG64 observed = InterlockedCompareExchange64((volatile LONG64*)p, desired, *expected);
-                if (observed == *expected) return 1;
-                *expected = observed;
-                return 0;
-            }
-
-            #define atomic_load(p) \
-                (sizeof(*(p)) == 8 ? (size_t)compat_atomic_load64((volatile LONG64*)(p)) \
-                                   : (LONG)InterlockedOr((volatile LONG*)(p), 0))
-
-            #define atomic_store(p, v) \
-                (sizeof(*(p)) == 8 ? compat_atomic_store64((volatile LONG64*)(p), (LONG64)(v)) \
-                                   : (void)InterlockedExchange((volatile LONG*)(p), (LONG)(v)))
-
-            #define atomic_fetch_add(p, v) \
-                (sizeof(*(p)) == 8 ? (size_t)InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(v)) \
-                                   : (LONG)InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(v)))
-
-            #define atomic_compare_exchange_strong(p, e, d) \
-                (sizeof(*(p)) == 8 ? compat_cas64((volatile LONG64*)(p), (LONG64*)(e), (LONG64)(d)) \
-                                   : ({ \
-                                       volatile LONG* _p = (volatile LONG*)(p); \
-                                       LONG* _e = (LONG*)(e); \
-                                       LONG _obs = InterlockedCompareExchange(_p, (LONG)(d), *_e); \
-                                       if (_obs == *_e) return 1; \
-                                       *_e = _obs; \
-                                       return 0; \
-                                     }))
-        #else
-            typedef volatile LONG atomic_size_t;
-
-            static inline LONG compat_atomic_load32(volatile LONG* p) {
-                return InterlockedOr((volatile LONG*)p, 0);
-            }
-
-            static inline void compat_atomic_store32(volatile LONG* p, LONG v) {
-                InterlockedExchange((volatile LONG*)p, v);
-            }
-
-            static inline int compat_cas32(volatile LONG* p, LONG* expected, LONG desired) {
-                LONG observed = InterlockedCompareExchange((volatile LONG*)p, desired, *expected);
-                if (observed == *expected) return 1;
-                *expected = observed;
-                return 0;
-            }
-
-            #define atomic_load(p) (compat_atomic_load32((volatile LONG*)(p)))
-            #define atomic_store(p, v) (compat_atomic_store32((volatile LONG*)(p), (LONG)(v)))
-            #define atomic_fetch_add(p, v) (InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(v)))
-            #define atomic_compare_exchange_strong(p, e, d) (compat_cas32((volatile LONG*)(p), (LONG*)(e), (LONG)(d)))
-        #endif
+        #error "fq needs C11 atomics: build with VS 2022 17.5+ and /std:c11 /experimental:c11atomics (nmake msvc-c11)"
     #endif
 
     #pragma warning(pop)
@@ -142,4 +68,10 @@
     #define _strdup compat_strdup_local
 #endif
 
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include "posix_compat.h"
+#endif
+
 #endif
@@ -4,6 +4,63 @@
 #include <stdio.h>
 #include <wchar.h>
 
+#define PLATFORM_NAME_ARENA_MIN_CAPACITY 4096
+
+bool platform_name_arena_init(platform_name_arena_t *arena, size_t initial_capacity) {
+    if (!arena) return false;
+
+    if (initial_capacity < PLATFORM_NAME_ARENA_MIN_CAPACITY) {
+        initial_capacity = PLATFORM_NAME_ARENA_MIN_CAPACITY;
+    }
+
+    arena->data = malloc(initial_capacity);
+    arena->capacity = arena->data ? initial_capacity : 0;
+    arena->used = 0;
+    return arena->data != NULL;
+}
+
+void platform_name_arena_reset(platform_name_arena_t *arena) {
+    if (arena) {
+        arena->used = 0;
+    }
+}
+
+void platform_name_arena_destroy(platform_name_arena_t *arena) {
+    if (!arena) return;
+
+    free(arena->data);
+    arena->data = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+// Make room for `bytes` more. Only an empty arena may grow: growing moves the
+// buffer, which would invalidate names already handed out in this batch.
+static bool name_arena_reserve(platform_name_arena_t *arena, size_t bytes) {
+    if (arena->used + bytes <= arena->capacity) return true;
+    if (arena->used > 0) return false;
+
+    size_t capacity = arena->capacity ? arena->capacity : PLATFORM_NAME_ARENA_MIN_CAPACITY;
+    while (capacity < bytes) {
+        capacity *= 2;
+    }
+
+    char *data = realloc(arena->data, capacity);
+    if (!data) return false;
+
+    arena->data = data;
+    arena->capacity = capacity;
+    return true;
+}
+
+static void* name_arena_take(platform_name_arena_t *arena, size_t bytes, size_t align) {
+    size_t start = (arena->used + align - 1) & ~(align - 1);
+    arena->used = start + bytes;
+    return arena->data + start;
+}
+
+#ifdef _WIN32
+
 int utf8_to_wide(const char *utf8_str, wchar_t **wide_str) {
     if (!utf8_str || !wide_str) return -1;
 
@@ -78,7 +135,10 @@ struct platform_dir_iter {
     HANDLE find_handle;
     WIN32_FIND_DATAW find_data;
     bool first_call;
+    bool has_pending;   // find_data holds an entry a batch could not fit yet
     wchar_t *search_pattern;
+    uint64_t device;    // volume serial; children inherit it from the parent
+    bool device_known;
 };
 
 platform_dir_iter_t* platform_opendir(const char *utf8_path) {
@@ -118,23 +178,166 @@ platform_dir_iter_t* platform_opendir(const char *utf8_path) {
     iter->search_pattern = search_pattern;
     iter->find_handle = INVALID_HANDLE_VALUE;
     iter->first_call = true;
+    iter->has_pending = false;
+    iter->device = 0;
+    iter->device_known = false;
 
     return iter;
 }
 
-bool platform_readdir(platform_dir_iter_t *iter, platform_file_info_t *info) {
-    if (!iter || !info) return false;
+platform_dir_iter_t* platform_opendir_at(platform_dir_iter_t *parent, const char *name) {
+    if (!parent || !name) return NULL;
+
+    wchar_t *wide_name;
+    if (utf8_to_wide(name, &wide_name) < 0) {
+        return NULL;
+    }
+
+    // The parent pattern is "<dir>\*"; keep "<dir>\" and append "<name>\*"
+    size_t dir_len = wcslen(parent->search_pattern) - 1;
+    size_t name_len = wcslen(wide_name);
+    bool needs_prefix = dir_len + name_len >= MAX_PATH && wcsncmp(parent->search_pattern, L"\\\\?\\", 4) != 0;
+    size_t prefix_len = needs_prefix ? 4 : 0;
+
+    wchar_t *search_pattern = malloc((prefix_len + dir_len + name_len + 3) * sizeof(wchar_t));
+    if (!search_pattern) {
+        free(wide_name);
+        return NULL;
+    }
+
+    wchar_t *p = search_pattern;
+    if (needs_prefix) {
+        memcpy(p, L"\\\\?\\", 4 * sizeof(wchar_t));
+        p += 4;
+    }
+    memcpy(p, parent->search_pattern, dir_len * sizeof(wchar_t));
+    p += dir_len;
+    memcpy(p, wide_name, name_len * sizeof(wchar_t));
+    p += name_len;
+    *p++ = L'\\';
+    *p++ = L'*';
+    *p = L'\0';
+
+    free(wide_name);
+
+    platform_dir_iter_t *iter = malloc(sizeof(platform_dir_iter_t));
+    if (!iter) {
+        free(search_pattern);
+        return NULL;
+    }
+
+    iter->search_pattern = search_pattern;
+    iter->find_handle = INVALID_HANDLE_VALUE;
+    iter->first_call = true;
+    iter->has_pending = false;
+    // Junctions to other volumes are rare enough to schedule as the parent's
+    iter->device = parent->device;
+    iter->device_known = parent->device_known;
+
+    return iter;
+}
 
-    BOOL found;
+uint64_t platform_dir_device(platform_dir_iter_t *iter) {
+    if (!iter) return 0;
+    if (iter->device_known) return iter->device;
+
+    iter->device_known = true;
+
+    // The pattern is "<dir>\*"; the volume root is resolved from "<dir>\"
+    size_t dir_len = wcslen(iter->search_pattern) - 1;
+    wchar_t *dir = malloc((dir_len + 1) * sizeof(wchar_t));
+    if (!dir) return 0;
+    memcpy(dir, iter->search_pattern, dir_len * sizeof(wchar_t));
+    dir[dir_len] = L'\0';
+
+    wchar_t volume[MAX_PATH + 1];
+    DWORD serial = 0;
+    if (GetVolumePathNameW(dir, volume, MAX_PATH + 1) &&
+        GetVolumeInformationW(volume, NULL, 0, &serial, NULL, NULL, NULL, 0)) {
+        iter->device = (uint64_t)serial + 1;
+    }
+    free(dir);
+    return iter->device;
+}
+
+bool platform_dir_file_id(platform_dir_iter_t *iter, platform_file_id_t *id) {
+    if (!iter || !id) return false;
+
+    // FindFirstFileW holds no handle to the directory itself, so open one
+    size_t dir_len = wcslen(iter->search_pattern) - 2;
+    wchar_t *dir = malloc((dir_len + 1) * sizeof(wchar_t));
+    if (!dir) return false;
+    memcpy(dir, iter->search_pattern, dir_len * sizeof(wchar_t));
+    dir[dir_len] = L'\0';
+
+    HANDLE handle = CreateFileW(dir, FILE_READ_ATTRIBUTES,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    free(dir);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(handle, &info);
+    CloseHandle(handle);
+    if (!ok) return false;
+
+    id->device = (uint64_t)info.dwVolumeSerialNumber + 1;
+    id->inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
+bool platform_dir_is_pseudo_fs(platform_dir_iter_t *iter) {
+    (void)iter;
+    return false;
+}
+
+size_t platform_dir_handle_budget(void) {
+    // Unread iterators hold only a search pattern, no kernel handle
+    return SIZE_MAX;
+}
+
+platform_io_engine_t* platform_io_engine_create(unsigned queue_depth) {
+    (void)queue_depth;
+    return NULL;
+}
+
+void platform_io_engine_destroy(platform_io_engine_t *engine) {
+    (void)engine;
+}
+
+void platform_dir_entries_load_metadata(platform_io_engine_t *engine, platform_dir_iter_t *iter,
+                                        platform_dir_entry_t **entries, size_t count, unsigned fields) {
+    (void)engine;
+    if (!iter || !entries) return;
+
+    for (size_t i = 0; i < count; i++) {
+        platform_dir_entry_load_metadata(iter, entries[i], fields);
+    }
+}
+
+void platform_opendir_at_batch(platform_io_engine_t *engine, platform_dir_iter_t *parent,
+                               const char **names, platform_dir_iter_t **out, size_t count) {
+    (void)engine;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = platform_opendir_at(parent, names[i]);
+    }
+}
+
+static bool platform_find_next(platform_dir_iter_t *iter) {
     if (iter->first_call) {
         iter->find_handle = FindFirstFileW(iter->search_pattern, &iter->find_data);
         iter->first_call = false;
-        found = (iter->find_handle != INVALID_HANDLE_VALUE);
-    } else {
-        found = FindNextFileW(iter->find_handle, &iter->find_data);
+        return iter->find_handle != INVALID_HANDLE_VALUE;
     }
 
-    if (!found) return false;
+    if (iter->find_handle == INVALID_HANDLE_VALUE) return false;
+    return FindNextFileW(iter->find_handle, &iter->find_data) != 0;
+}
+
+bool platform_readdir(platform_dir_iter_t *iter, platform_file_info_t *info) {
+    if (!iter || !info) return false;
+
+    if (!platform_find_next(iter)) return false;
 
     if (wcscmp(iter->find_data.cFileName, L".") == 0 ||
         wcscmp(iter->find_data.cFileName, L"..") == 0) {
@@ -160,6 +363,105 @@ bool platform_readdir(platform_dir_iter_t *iter, platform_file_info_t *info) {
     return true;
 }
 
+size_t platform_readdir_batch(platform_dir_iter_t *iter, platform_dir_entry_t *entries,
+                              size_t max_entries, platform_name_arena_t *arena, unsigned flags) {
+    if (!iter || !entries || !arena || max_entries == 0) return 0;
+
+    platform_name_arena_reset(arena);
+
+    size_t count = 0;
+    while (count < max_entries) {
+        if (!iter->has_pending) {
+            if (!platform_find_next(iter)) break;
+            iter->has_pending = true;
+        }
+
+        const wchar_t *wide_name = iter->find_data.cFileName;
+        if (wcscmp(wide_name, L".") == 0 || wcscmp(wide_name, L"..") == 0) {
+            iter->has_pending = false;
+            continue;
+        }
+
+        int utf8_len = WideCharToMultiByte(CP_UTF8, 0, wide_name, -1, NULL, 0, NULL, NULL);
+        if (utf8_len <= 0) {
+            iter->has_pending = false;
+            continue;
+        }
+
+        size_t wide_bytes = (flags & PLATFORM_READDIR_WIDE_NAMES) ? (wcslen(wide_name) + 1) * sizeof(wchar_t) : 0;
+        if (!name_arena_reserve(arena, (size_t)utf8_len + wide_bytes + sizeof(wchar_t))) {
+            break; // arena full: the pending entry starts the next batch
+        }
+
+        platform_dir_entry_t *entry = &entries[count];
+        char *name = name_arena_take(arena, (size_t)utf8_len, 1);
+        WideCharToMultiByte(CP_UTF8, 0, wide_name, -1, name, utf8_len, NULL, NULL);
+        entry->name = name;
+        entry->name_wide = NULL;
+        if (wide_bytes) {
+            wchar_t *copy = name_arena_take(arena, wide_bytes, sizeof(wchar_t));
+            memcpy(copy, wide_name, wide_bytes);
+            entry->name_wide = copy;
+        }
+
+        entry->size = ((uint64_t)iter->find_data.nFileSizeHigh << 32) | iter->find_data.nFileSizeLow;
+        entry->mtime = iter->find_data.ftLastWriteTime;
+        entry->id.device = 0;
+        entry->id.inode = 0;
+        entry->link_count = 0;
+        entry->metadata = PLATFORM_METADATA_ALL;
+        entry->is_directory = (iter->find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry->is_symlink = (iter->find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+
+        iter->has_pending = false;
+        count++;
+    }
+
+    return count;
+}
+
+bool platform_dir_entry_load_metadata(platform_dir_iter_t *iter, platform_dir_entry_t *entry, unsigned fields) {
+    if (!iter || !entry) return false;
+
+    // FindNextFileW already returned size and timestamps with the name;
+    // only link count and file index need the file opened
+    fields &= ~entry->metadata;
+    if (!(fields & PLATFORM_METADATA_LINKS)) return true;
+
+    entry->metadata |= PLATFORM_METADATA_LINKS;
+
+    wchar_t *wide_name;
+    if (utf8_to_wide(entry->name, &wide_name) < 0) return false;
+
+    // The pattern is "<dir>\*"; keep "<dir>\" and append the name
+    size_t dir_len = wcslen(iter->search_pattern) - 1;
+    size_t name_len = wcslen(wide_name);
+    wchar_t *path = malloc((dir_len + name_len + 1) * sizeof(wchar_t));
+    if (!path) {
+        free(wide_name);
+        return false;
+    }
+    memcpy(path, iter->search_pattern, dir_len * sizeof(wchar_t));
+    memcpy(path + dir_len, wide_name, (name_len + 1) * sizeof(wchar_t));
+    free(wide_name);
+
+    HANDLE handle = CreateFileW(path, FILE_READ_ATTRIBUTES,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, NULL);
+    free(path);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(handle, &info);
+    CloseHandle(handle);
+    if (!ok) return false;
+
+    entry->link_count = info.nNumberOfLinks;
+    entry->id.device = (uint64_t)info.dwVolumeSerialNumber + 1;
+    entry->id.inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
 void platform_closedir(platform_dir_iter_t *iter) {
     if (!iter) return;
 
@@ -178,3 +480,858 @@ void platform_free_file_info(platform_file_info_t *info) {
     free(info->name_wide);
     memset(info, 0, sizeof(*info));
 }
+
+bool platform_get_file_size(const char *utf8_path, uint64_t *size) {
+    if (!utf8_path || !size) return false;
+
+    wchar_t *wide_path;
+    if (FAILED(make_long_path(utf8_path, &wide_path))) {
+        return false;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    BOOL ok = GetFileAttributesExW(wide_path, GetFileExInfoStandard, &data);
+    free(wide_path);
+    if (!ok) return false;
+
+    *size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return true;
+}
+
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+static size_t utf8_decode(const unsigned char *s, uint32_t *cp) {
+    if (s[0] < 0x80) {
+        *cp = s[0];
+        return 1;
+    }
+    if ((s[0] & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+        return *cp >= 0x80 ? 2 : 0;
+    }
+    if ((s[0] & 0xF0) == 0xE0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        return (*cp >= 0x800 && (*cp < 0xD800 || *cp > 0xDFFF)) ? 3 : 0;
+    }
+    if ((s[0] & 0xF8) == 0xF0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) |
+              ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        return (*cp >= 0x10000 && *cp <= 0x10FFFF) ? 4 : 0;
+    }
+    return 0;
+}
+
+// Decode into `out`, which must hold strlen(utf8_str) + 1 wide chars.
+// Invalid sequences become U+FFFD, matching MultiByteToWideChar without flags.
+static size_t utf8_to_wide_into(const char *utf8_str, wchar_t *out) {
+    const unsigned char *p = (const unsigned char*)utf8_str;
+    size_t len = 0;
+    while (*p) {
+        uint32_t cp;
+        size_t n = utf8_decode(p, &cp);
+        if (n == 0) {
+            cp = 0xFFFD;
+            n = 1;
+        }
+        out[len++] = (wchar_t)cp;
+        p += n;
+    }
+    out[len++] = L'\0';
+    return len;
+}
+
+int utf8_to_wide(const char *utf8_str, wchar_t **wide_str) {
+    if (!utf8_str || !wide_str) return -1;
+
+    size_t byte_len = strlen(utf8_str);
+    *wide_str = malloc((byte_len + 1) * sizeof(wchar_t));
+    if (!*wide_str) return -1;
+
+    return (int)utf8_to_wide_into(utf8_str, *wide_str);
+}
+
+int wide_to_utf8(const wchar_t *wide_str, char **utf8_str) {
+    if (!wide_str || !utf8_str) return -1;
+
+    size_t wide_len = wcslen(wide_str);
+    *utf8_str = malloc(wide_len * 4 + 1);
+    if (!*utf8_str) return -1;
+
+    unsigned char *out = (unsigned char*)*utf8_str;
+    for (size_t i = 0; i < wide_len; i++) {
+        uint32_t cp = (uint32_t)wide_str[i];
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            cp = 0xFFFD;
+        }
+        if (cp < 0x80) {
+            *out++ = (unsigned char)cp;
+        } else if (cp < 0x800) {
+            *out++ = (unsigned char)(0xC0 | (cp >> 6));
+            *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            *out++ = (unsigned char)(0xE0 | (cp >> 12));
+            *out++ = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+        } else {
+            *out++ = (unsigned char)(0xF0 | (cp >> 18));
+            *out++ = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+            *out++ = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+        }
+    }
+    *out++ = '\0';
+
+    return (int)(out - (unsigned char*)*utf8_str);
+}
+
+void free_converted_string(void *str) {
+    free(str);
+}
+
+// Large enough that typical directories come back in a single getdents64 call
+#define PLATFORM_DIRENT_BUFFER_SIZE (64 * 1024)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// An open-but-unread iterator is just the fd; the read buffer is only
+// allocated once enumeration starts, so queued directories stay small.
+struct platform_dir_iter {
+    int fd;
+    char *buf;
+    size_t buf_len;
+    size_t buf_pos;
+    bool eof;
+    uint64_t device;
+    uint64_t inode;
+    bool stat_done;     // device/inode hold the fstat of fd
+};
+
+static platform_dir_iter_t* platform_dir_iter_from_fd(int fd) {
+    platform_dir_iter_t *iter = malloc(sizeof(platform_dir_iter_t));
+    if (!iter) {
+        close(fd);
+        return NULL;
+    }
+
+    iter->fd = fd;
+    iter->buf = NULL;
+    iter->buf_len = 0;
+    iter->buf_pos = 0;
+    iter->eof = false;
+    iter->device = 0;
+    iter->inode = 0;
+    iter->stat_done = false;
+
+    return iter;
+}
+
+platform_dir_iter_t* platform_opendir(const char *utf8_path) {
+    if (!utf8_path) return NULL;
+
+    int fd = open(utf8_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    return platform_dir_iter_from_fd(fd);
+}
+
+platform_dir_iter_t* platform_opendir_at(platform_dir_iter_t *parent, const char *name) {
+    if (!parent || !name) return NULL;
+
+    int fd = openat(parent->fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    return platform_dir_iter_from_fd(fd);
+}
+
+static void platform_dir_stat_once(platform_dir_iter_t *iter) {
+    if (iter->stat_done) return;
+
+    struct stat st;
+    iter->stat_done = true;
+    if (fstat(iter->fd, &st) == 0) {
+        // +1 keeps a real st_dev of 0 distinct from "unknown"
+        iter->device = (uint64_t)st.st_dev + 1;
+        iter->inode = (uint64_t)st.st_ino;
+    }
+}
+
+uint64_t platform_dir_device(platform_dir_iter_t *iter) {
+    if (!iter) return 0;
+    platform_dir_stat_once(iter);
+    return iter->device;
+}
+
+bool platform_dir_file_id(platform_dir_iter_t *iter, platform_file_id_t *id) {
+    if (!iter || !id) return false;
+    platform_dir_stat_once(iter);
+    id->device = iter->device;
+    id->inode = iter->inode;
+    return iter->device != 0;
+}
+
+// statfs f_type values of filesystems the kernel synthesizes
+static const unsigned long pseudo_fs_magics[] = {
+    0x9fa0,         // proc
+    0x62656572,     // sysfs
+    0x1cd1,         // devpts
+    0x27e0eb,       // cgroup
+    0x63677270,     // cgroup2
+    0x74726163,     // tracefs
+    0x64626720,     // debugfs
+    0x73636673,     // securityfs
+    0x6165676c,     // pstore
+    0xcafe4a11,     // bpf
+    0x62656570,     // configfs
+    0x65735543,     // fusectl
+    0x19800202,     // mqueue
+    0x42494e4d,     // binfmt_misc
+    0xde5e81e4,     // efivarfs
+    0xf97cff8c,     // selinuxfs
+    0x6e736673,     // nsfs
+    0x67596969,     // rpc_pipefs
+};
+
+#define PSEUDO_FS_TMPFS_MAGIC 0x01021994
+#define PSEUDO_FS_MAX_DEVTMPFS 8
+
+// devtmpfs reports tmpfs's magic, so it is told apart by device number,
+// taken once from the mount table
+static dev_t devtmpfs_devices[PSEUDO_FS_MAX_DEVTMPFS];
+static size_t devtmpfs_count;
+static pthread_once_t devtmpfs_once = PTHREAD_ONCE_INIT;
+
+static void devtmpfs_scan_mounts(void) {
+    FILE *mounts = fopen("/proc/self/mountinfo", "r");
+    if (!mounts) return;
+
+    // "<id> <parent> <major>:<minor> <root> <mount point> <options> ... - <fstype> ..."
+    char line[1024];
+    while (fgets(line, sizeof(line), mounts) && devtmpfs_count < PSEUDO_FS_MAX_DEVTMPFS) {
+        unsigned major_num, minor_num;
+        const char *fstype = strstr(line, " - ");
+        if (!fstype || sscanf(line, "%*u %*u %u:%u", &major_num, &minor_num) != 2) {
+            continue;
+        }
+        if (strncmp(fstype + 3, "devtmpfs ", 9) == 0) {
+            devtmpfs_devices[devtmpfs_count++] = makedev(major_num, minor_num);
+        }
+    }
+    fclose(mounts);
+}
+
+bool platform_dir_is_pseudo_fs(platform_dir_iter_t *iter) {
+    if (!iter) return false;
+
+    struct statfs fs;
+    if (fstatfs(iter->fd, &fs) != 0) return false;
+
+    unsigned long magic = (unsigned long)fs.f_type;
+    for (size_t i = 0; i < sizeof(pseudo_fs_magics) / sizeof(pseudo_fs_magics[0]); i++) {
+        if (magic == pseudo_fs_magics[i]) return true;
+    }
+
+    if (magic == PSEUDO_FS_TMPFS_MAGIC) {
+        uint64_t device = platform_dir_device(iter);
+        pthread_once(&devtmpfs_once, devtmpfs_scan_mounts);
+        for (size_t i = 0; i < devtmpfs_count; i++) {
+            if (device == (uint64_t)devtmpfs_devices[i] + 1) return true;
+        }
+    }
+    return false;
+}
+
+size_t platform_dir_handle_budget(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+        return 1024;
+    }
+    // Leave half the descriptor table for workers, output files and libc
+    return (size_t)(limit.rlim_cur / 2);
+}
+
+// Returns the next entry other than "." and ".." without consuming it
+static struct linux_dirent64* platform_peek_dirent(platform_dir_iter_t *iter) {
+    for (;;) {
+        if (iter->buf_pos >= iter->buf_len) {
+            if (iter->eof) return NULL;
+
+            if (!iter->buf) {
+                iter->buf = malloc(PLATFORM_DIRENT_BUFFER_SIZE);
+                if (!iter->buf) {
+                    iter->eof = true;
+                    return NULL;
+                }
+            }
+
+            long n = syscall(SYS_getdents64, iter->fd, iter->buf, PLATFORM_DIRENT_BUFFER_SIZE);
+            if (n <= 0) {
+                iter->eof = true;
+                return NULL;
+            }
+            iter->buf_len = (size_t)n;
+            iter->buf_pos = 0;
+        }
+
+        struct linux_dirent64 *entry = (struct linux_dirent64*)(iter->buf + iter->buf_pos);
+        const char *n = entry->d_name;
+        if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0'))) {
+            iter->buf_pos += entry->d_reclen;
+            continue;
+        }
+        return entry;
+    }
+}
+
+static void platform_consume_dirent(platform_dir_iter_t *iter, const struct linux_dirent64 *entry) {
+    iter->buf_pos += entry->d_reclen;
+}
+
+// Like a Windows directory junction, a link to a directory is reported as both
+static bool platform_link_is_directory(int dir_fd, const char *name) {
+    struct stat target;
+    return fstatat(dir_fd, name, &target, 0) == 0 && S_ISDIR(target.st_mode);
+}
+
+// For filesystems that report DT_UNKNOWN: one fstatat supplies the type,
+// and the size and time come with it
+static void platform_classify_dirent(int dir_fd, const struct linux_dirent64 *entry,
+                                     bool *is_directory, bool *is_symlink,
+                                     uint64_t *size, FILETIME *mtime) {
+    *is_directory = false;
+    *is_symlink = false;
+    *size = 0;
+    mtime->dwLowDateTime = 0;
+    mtime->dwHighDateTime = 0;
+
+    struct stat st;
+    if (fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        *is_directory = S_ISDIR(st.st_mode);
+        *is_symlink = S_ISLNK(st.st_mode);
+        if (!S_ISDIR(st.st_mode) && !S_ISLNK(st.st_mode)) {
+            *size = (uint64_t)st.st_size;
+        }
+        *mtime = compat_timespec_to_filetime(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    }
+
+    if (*is_symlink && platform_link_is_directory(dir_fd, entry->d_name)) {
+        *is_directory = true;
+    }
+}
+
+size_t platform_readdir_batch(platform_dir_iter_t *iter, platform_dir_entry_t *entries,
+                              size_t max_entries, platform_name_arena_t *arena, unsigned flags) {
+    if (!iter || !entries || !arena || max_entries == 0) return 0;
+
+    platform_name_arena_reset(arena);
+
+    size_t count = 0;
+    while (count < max_entries) {
+        struct linux_dirent64 *dirent = platform_peek_dirent(iter);
+        if (!dirent) break;
+
+        size_t name_len = strlen(dirent->d_name) + 1;
+        size_t wide_bytes = (flags & PLATFORM_READDIR_WIDE_NAMES) ? name_len * sizeof(wchar_t) : 0;
+        if (!name_arena_reserve(arena, name_len + wide_bytes + sizeof(wchar_t))) {
+            break; // arena full: the peeked entry starts the next batch
+        }
+        platform_consume_dirent(iter, dirent);
+
+        platform_dir_entry_t *entry = &entries[count];
+        char *name = name_arena_take(arena, name_len, 1);
+        memcpy(name, dirent->d_name, name_len);
+        entry->name = name;
+        entry->name_wide = NULL;
+        if (wide_bytes) {
+            wchar_t *wide = name_arena_take(arena, wide_bytes, sizeof(wchar_t));
+            utf8_to_wide_into(name, wide);
+            entry->name_wide = wide;
+        }
+
+        // d_type answers "file or directory?" for free; metadata waits until a
+        // size or time filter actually asks for it
+        entry->size = 0;
+        entry->mtime.dwLowDateTime = 0;
+        entry->mtime.dwHighDateTime = 0;
+        entry->id.device = 0;
+        entry->id.inode = 0;
+        entry->link_count = 0;
+        entry->metadata = 0;
+        entry->is_directory = (dirent->d_type == DT_DIR);
+        entry->is_symlink = (dirent->d_type == DT_LNK);
+        if (dirent->d_type == DT_LNK) {
+            // Only the target's type is needed here; the link's own size and
+            // time load with everyone else's when a filter asks for them
+            entry->is_directory = platform_link_is_directory(iter->fd, dirent->d_name);
+        } else if (dirent->d_type == DT_UNKNOWN) {
+            platform_classify_dirent(iter->fd, dirent, &entry->is_directory, &entry->is_symlink,
+                                     &entry->size, &entry->mtime);
+            entry->metadata = PLATFORM_METADATA_ALL;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+#ifdef STATX_SIZE
+static unsigned int metadata_statx_mask(unsigned fields) {
+    unsigned int mask = 0;
+    if (fields & PLATFORM_METADATA_SIZE) mask |= STATX_SIZE;
+    if (fields & PLATFORM_METADATA_MTIME) mask |= STATX_MTIME;
+    if (fields & PLATFORM_METADATA_LINKS) mask |= STATX_NLINK | STATX_INO;
+    return mask;
+}
+
+static void metadata_apply_statx(platform_dir_entry_t *entry, unsigned fields, const struct statx *stx) {
+    if ((fields & PLATFORM_METADATA_SIZE) && (stx->stx_mask & STATX_SIZE) &&
+        !entry->is_directory && !entry->is_symlink) {
+        entry->size = (uint64_t)stx->stx_size;
+    }
+    if ((fields & PLATFORM_METADATA_MTIME) && (stx->stx_mask & STATX_MTIME)) {
+        entry->mtime = compat_timespec_to_filetime(stx->stx_mtime.tv_sec, (long)stx->stx_mtime.tv_nsec);
+    }
+    if ((fields & PLATFORM_METADATA_LINKS) && (stx->stx_mask & STATX_NLINK) && (stx->stx_mask & STATX_INO)) {
+        entry->link_count = stx->stx_nlink;
+        entry->id.device = (uint64_t)makedev(stx->stx_dev_major, stx->stx_dev_minor) + 1;
+        entry->id.inode = stx->stx_ino;
+    }
+}
+#endif
+
+bool platform_dir_entry_load_metadata(platform_dir_iter_t *iter, platform_dir_entry_t *entry, unsigned fields) {
+    if (!iter || !entry) return false;
+
+    fields &= ~entry->metadata;
+    if (!fields) return true;
+
+    // Whatever happens, don't stat this entry again; failures read as zero
+    entry->metadata |= fields;
+
+#ifdef STATX_SIZE
+    struct statx stx;
+    if (statx(iter->fd, entry->name, AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT,
+              metadata_statx_mask(fields), &stx) != 0) {
+        return false;
+    }
+    metadata_apply_statx(entry, fields, &stx);
+#else
+    struct stat st;
+    if (fstatat(iter->fd, entry->name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return false;
+    }
+
+    if ((fields & PLATFORM_METADATA_SIZE) && !entry->is_directory && !entry->is_symlink) {
+        entry->size = (uint64_t)st.st_size;
+    }
+    if (fields & PLATFORM_METADATA_MTIME) {
+        entry->mtime = compat_timespec_to_filetime(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    }
+    if (fields & PLATFORM_METADATA_LINKS) {
+        entry->link_count = (uint32_t)st.st_nlink;
+        entry->id.device = (uint64_t)st.st_dev + 1;
+        entry->id.inode = (uint64_t)st.st_ino;
+    }
+#endif
+
+    return true;
+}
+
+#if defined(STATX_SIZE) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define PLATFORM_HAVE_IO_URING
+    #endif
+#endif
+
+#ifdef PLATFORM_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+// Minimal raw io_uring: one ring per worker, used synchronously per batch
+// (submit everything, then reap completions as they arrive).
+struct platform_io_engine {
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    struct statx *statx_buffers;    // one per submission slot
+    bool failed;                    // ring state unknown after an error; stop using it
+};
+
+static bool io_engine_probe(int ring_fd) {
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    if (!probe) return false;
+
+    bool supported = false;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        supported = probe->last_op >= IORING_OP_STATX &&
+                    (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) &&
+                    (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return supported;
+}
+
+platform_io_engine_t* platform_io_engine_create(unsigned queue_depth) {
+    if (queue_depth == 0) return NULL;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // ENOSYS, EPERM (seccomp, io_uring_disabled) and friends all mean "fall back"
+    int ring_fd = (int)syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd < 0) return NULL;
+
+    platform_io_engine_t *engine = calloc(1, sizeof(platform_io_engine_t));
+    if (!engine || !io_engine_probe(ring_fd)) {
+        free(engine);
+        close(ring_fd);
+        return NULL;
+    }
+
+    engine->ring_fd = ring_fd;
+    engine->sq_entries = params.sq_entries;
+    engine->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    engine->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    engine->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && engine->cq_ring_size > engine->sq_ring_size) {
+        engine->sq_ring_size = engine->cq_ring_size;
+    }
+
+    engine->sq_ring = mmap(NULL, engine->sq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (engine->sq_ring == MAP_FAILED) {
+        engine->sq_ring = NULL;
+        platform_io_engine_destroy(engine);
+        return NULL;
+    }
+
+    if (single_mmap) {
+        engine->cq_ring = engine->sq_ring;
+    } else {
+        engine->cq_ring = mmap(NULL, engine->cq_ring_size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (engine->cq_ring == MAP_FAILED) {
+            engine->cq_ring = NULL;
+            platform_io_engine_destroy(engine);
+            return NULL;
+        }
+    }
+
+    engine->sqes = mmap(NULL, engine->sqes_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (engine->sqes == MAP_FAILED) {
+        engine->sqes = NULL;
+        platform_io_engine_destroy(engine);
+        return NULL;
+    }
+
+    char *sq = (char*)engine->sq_ring;
+    char *cq = (char*)engine->cq_ring;
+    engine->sq_head = (unsigned*)(sq + params.sq_off.head);
+    engine->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    engine->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    engine->sq_array = (unsigned*)(sq + params.sq_off.array);
+    engine->cq_head = (unsigned*)(cq + params.cq_off.head);
+    engine->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    engine->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    engine->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    engine->statx_buffers = malloc(engine->sq_entries * sizeof(struct statx));
+    if (!engine->statx_buffers) {
+        platform_io_engine_destroy(engine);
+        return NULL;
+    }
+
+    return engine;
+}
+
+void platform_io_engine_destroy(platform_io_engine_t *engine) {
+    if (!engine) return;
+
+    if (engine->sqes) munmap(engine->sqes, engine->sqes_size);
+    if (engine->cq_ring && engine->cq_ring != engine->sq_ring) munmap(engine->cq_ring, engine->cq_ring_size);
+    if (engine->sq_ring) munmap(engine->sq_ring, engine->sq_ring_size);
+    if (engine->ring_fd >= 0) close(engine->ring_fd);
+    free(engine->statx_buffers);
+    free(engine);
+}
+
+static struct io_uring_sqe* io_engine_next_sqe(platform_io_engine_t *engine, unsigned slot) {
+    unsigned tail = *engine->sq_tail;
+    unsigned index = tail & *engine->sq_mask;
+    struct io_uring_sqe *sqe = &engine->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = slot;
+    engine->sq_array[index] = index;
+    __atomic_store_n(engine->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+typedef void (*io_engine_complete_t)(void *ctx, unsigned slot, int result);
+
+#define IO_ENGINE_RETRY_LIMIT 64     // busy rounds without any completion before giving up
+
+// Submit `count` queued SQEs and hand each completion to `complete`. Returns
+// false if the ring failed; even then every submitted SQE has completed (or
+// the ring is beyond use), so no buffer or opened fd is left in flight.
+static bool io_engine_run(platform_io_engine_t *engine, unsigned count,
+                          io_engine_complete_t complete, void *ctx) {
+    unsigned to_submit = count;
+    unsigned pending = count;
+    unsigned busy_rounds = 0;
+
+    while (pending > 0) {
+        int ret = (int)syscall(__NR_io_uring_enter, engine->ring_fd, to_submit, 1,
+                               IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+
+            // Out of kernel resources or completions backed up: reap below and retry
+            bool busy = (errno == EAGAIN || errno == EBUSY) && ++busy_rounds <= IO_ENGINE_RETRY_LIMIT;
+            if (!busy && !engine->failed) {
+                // Take back what the kernel never consumed and wait out the rest
+                engine->failed = true;
+                __atomic_store_n(engine->sq_tail, *engine->sq_tail - to_submit, __ATOMIC_RELEASE);
+                pending -= to_submit;
+                to_submit = 0;
+            } else if (!busy) {
+                return false;   // can't even wait: the ring is beyond use
+            }
+        } else {
+            to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+        }
+
+        unsigned head = *engine->cq_head;
+        unsigned tail = __atomic_load_n(engine->cq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            busy_rounds = 0;
+        } else if (ret < 0 && !engine->failed) {
+            sched_yield();
+        }
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &engine->cqes[head & *engine->cq_mask];
+            complete(ctx, (unsigned)cqe->user_data, cqe->res);
+            head++;
+            pending--;
+        }
+        __atomic_store_n(engine->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return !engine->failed;
+}
+
+typedef struct {
+    platform_io_engine_t *engine;
+    platform_dir_entry_t **slot_entries;
+    unsigned *slot_fields;
+} io_statx_ctx_t;
+
+static void io_statx_complete(void *ctx, unsigned slot, int result) {
+    io_statx_ctx_t *c = (io_statx_ctx_t*)ctx;
+    if (result == 0) {
+        metadata_apply_statx(c->slot_entries[slot], c->slot_fields[slot], &c->engine->statx_buffers[slot]);
+        c->slot_entries[slot]->metadata |= c->slot_fields[slot];
+    }
+}
+
+// Loads what it can; entries whose completion failed stay unmarked
+static void io_engine_load_metadata(platform_io_engine_t *engine, platform_dir_iter_t *iter,
+                                    platform_dir_entry_t **entries, size_t count, unsigned fields) {
+    platform_dir_entry_t *slot_entries[256];
+    unsigned slot_fields[256];
+    unsigned depth = engine->sq_entries < 256 ? engine->sq_entries : 256;
+    io_statx_ctx_t ctx = { engine, slot_entries, slot_fields };
+
+    size_t i = 0;
+    while (i < count) {
+        unsigned queued = 0;
+        for (; i < count && queued < depth; i++) {
+            platform_dir_entry_t *entry = entries[i];
+            unsigned wanted = fields & ~entry->metadata;
+            if (!wanted) continue;
+
+            struct io_uring_sqe *sqe = io_engine_next_sqe(engine, queued);
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = iter->fd;
+            sqe->addr = (uint64_t)(uintptr_t)entry->name;
+            sqe->len = metadata_statx_mask(wanted);
+            sqe->off = (uint64_t)(uintptr_t)&engine->statx_buffers[queued];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT;
+            slot_entries[queued] = entry;
+            slot_fields[queued] = wanted;
+            queued++;
+        }
+        if (queued > 0 && !io_engine_run(engine, queued, io_statx_complete, &ctx)) {
+            return;
+        }
+    }
+}
+
+typedef struct {
+    platform_dir_iter_t **out;
+    size_t base;
+} io_open_ctx_t;
+
+// Marks a slot whose OPENAT completed with an error, so the fallback pass
+// does not repeat the open synchronously
+static platform_dir_iter_t io_open_failed;
+
+static void io_open_complete(void *ctx, unsigned slot, int result) {
+    io_open_ctx_t *c = (io_open_ctx_t*)ctx;
+    platform_dir_iter_t *dir = result >= 0 ? platform_dir_iter_from_fd(result) : NULL;
+    c->out[c->base + slot] = dir ? dir : &io_open_failed;
+}
+
+static bool io_engine_opendir_at(platform_io_engine_t *engine, platform_dir_iter_t *parent,
+                                 const char **names, platform_dir_iter_t **out, size_t count) {
+    unsigned depth = engine->sq_entries;
+
+    for (size_t base = 0; base < count; base += depth) {
+        unsigned queued = (unsigned)(count - base < depth ? count - base : depth);
+        for (unsigned slot = 0; slot < queued; slot++) {
+            struct io_uring_sqe *sqe = io_engine_next_sqe(engine, slot);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = parent->fd;
+            sqe->addr = (uint64_t)(uintptr_t)names[base + slot];
+            sqe->open_flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+        }
+
+        io_open_ctx_t ctx = { out, base };
+        if (!io_engine_run(engine, queued, io_open_complete, &ctx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#else
+
+platform_io_engine_t* platform_io_engine_create(unsigned queue_depth) {
+    (void)queue_depth;
+    return NULL;
+}
+
+void platform_io_engine_destroy(platform_io_engine_t *engine) {
+    (void)engine;
+}
+
+#endif
+
+void platform_dir_entries_load_metadata(platform_io_engine_t *engine, platform_dir_iter_t *iter,
+                                        platform_dir_entry_t **entries, size_t count, unsigned fields) {
+    if (!iter || !entries) return;
+
+#ifdef PLATFORM_HAVE_IO_URING
+    if (engine && !engine->failed) {
+        io_engine_load_metadata(engine, iter, entries, count, fields);
+    }
+#else
+    (void)engine;
+#endif
+
+    // Entries the ring loaded are marked and skipped; the rest (failed
+    // completions, or everything once the ring failed) are stat'ed here
+    for (size_t i = 0; i < count; i++) {
+        platform_dir_entry_load_metadata(iter, entries[i], fields);
+    }
+}
+
+void platform_opendir_at_batch(platform_io_engine_t *engine, platform_dir_iter_t *parent,
+                               const char **names, platform_dir_iter_t **out, size_t count) {
+    if (!parent || !names || !out) return;
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = NULL;
+    }
+
+#ifdef PLATFORM_HAVE_IO_URING
+    if (engine && !engine->failed) {
+        io_engine_opendir_at(engine, parent, names, out, count);
+    }
+#else
+    (void)engine;
+#endif
+
+    // Only slots the ring never submitted or completed are opened here;
+    // a completion that failed (EACCES, ENOENT, ...) stays failed
+    for (size_t i = 0; i < count; i++) {
+#ifdef PLATFORM_HAVE_IO_URING
+        if (out[i] == &io_open_failed) {
+            out[i] = NULL;
+            continue;
+        }
+#endif
+        if (!out[i]) {
+            out[i] = platform_opendir_at(parent, names[i]);
+        }
+    }
+}
+
+void platform_closedir(platform_dir_iter_t *iter) {
+    if (!iter) return;
+
+    if (iter->fd >= 0) {
+        close(iter->fd);
+    }
+
+    free(iter->buf);
+    free(iter);
+}
+
+void platform_free_file_info(platform_file_info_t *info) {
+    if (!info) return;
+
+    free(info->name);
+    free(info->name_wide);
+    memset(info, 0, sizeof(*info));
+}
+
+bool platform_get_file_size(const char *utf8_path, uint64_t *size) {
+    if (!utf8_path || !size) return false;
+
+    struct stat st;
+    if (stat(utf8_path, &st) != 0) return false;
+
+    *size = (uint64_t)st.st_size;
+    return true;
+}
+
+#endif
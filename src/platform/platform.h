@@ -2,7 +2,6 @@
 #define PLATFORM_H
 
 #include "compat.h"
-#include <windows.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,6 +16,7 @@ static inline size_t compat_strnlen_local(const char *s, size_t maxlen) {
     return len;
 }
 
+#ifdef _WIN32
 typedef struct {
     HANDLE handle;
     bool valid;
@@ -34,6 +34,7 @@ static inline void auto_handle_close(auto_handle_t *ah) {
         ah->valid = false;
     }
 }
+#endif
 
 static inline HRESULT safe_strcpy(char *dest, size_t dest_size, const char *src) {
     if (!dest || !src || dest_size == 0) return E_INVALIDARG;
@@ -49,11 +50,19 @@ static inline HRESULT safe_strcat(char *dest, size_t dest_size, const char *src)
     return (written >= 0 && (size_t)written < dest_size - len) ? S_OK : HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
 }
 
+#ifdef _WIN32
+    #define PLATFORM_PATH_SEP '\\'
+#else
+    #define PLATFORM_PATH_SEP '/'
+#endif
+
 int utf8_to_wide(const char *utf8_str, wchar_t **wide_str);
 int wide_to_utf8(const wchar_t *wide_str, char **utf8_str);
 void free_converted_string(void *str);
 
+#ifdef _WIN32
 HRESULT make_long_path(const char *path, wchar_t **long_path);
+#endif
 
 typedef struct platform_dir_iter platform_dir_iter_t;
 typedef struct {
@@ -66,8 +75,92 @@ typedef struct {
 } platform_file_info_t;
 
 platform_dir_iter_t* platform_opendir(const char *utf8_path);
+// Open a child of a directory that is still open, without re-resolving its path
+platform_dir_iter_t* platform_opendir_at(platform_dir_iter_t *parent, const char *name);
+#ifdef _WIN32
+// One entry at a time with its metadata; the Linux backend only reads in
+// batches (platform_readdir_batch)
 bool platform_readdir(platform_dir_iter_t *iter, platform_file_info_t *info);
+#endif
 void platform_closedir(platform_dir_iter_t *iter);
 void platform_free_file_info(platform_file_info_t *info);
 
+bool platform_get_file_size(const char *utf8_path, uint64_t *size);
+
+// Identity of the filesystem/volume a directory lives on, for scheduling;
+// 0 if unknown. Computed once per iterator.
+uint64_t platform_dir_device(platform_dir_iter_t *iter);
+
+// Physical identity of a file or directory; device matches platform_dir_device
+typedef struct {
+    uint64_t device;
+    uint64_t inode;
+} platform_file_id_t;
+
+// Identity of the directory itself, for cycle detection when following links
+bool platform_dir_file_id(platform_dir_iter_t *iter, platform_file_id_t *id);
+
+// True for kernel-generated filesystems (procfs, sysfs, devtmpfs, cgroupfs,
+// tracefs, ...) that hold no user files; always false on Windows
+bool platform_dir_is_pseudo_fs(platform_dir_iter_t *iter);
+
+// How many opened-but-unread directories may be held at once without
+// risking descriptor exhaustion
+size_t platform_dir_handle_budget(void);
+
+// Batched enumeration: names live in a caller-owned arena that is reset on
+// every batch, so steady-state reads make no allocator calls per entry.
+typedef struct {
+    char *data;
+    size_t capacity;
+    size_t used;
+} platform_name_arena_t;
+
+bool platform_name_arena_init(platform_name_arena_t *arena, size_t initial_capacity);
+void platform_name_arena_reset(platform_name_arena_t *arena);
+void platform_name_arena_destroy(platform_name_arena_t *arena);
+
+#define PLATFORM_METADATA_SIZE  0x1u
+#define PLATFORM_METADATA_MTIME 0x2u
+#define PLATFORM_METADATA_LINKS 0x4u   // link_count and id
+#define PLATFORM_METADATA_ALL   (PLATFORM_METADATA_SIZE | PLATFORM_METADATA_MTIME)
+
+typedef struct {
+    const char *name;
+    const wchar_t *name_wide;   // NULL unless PLATFORM_READDIR_WIDE_NAMES was requested
+    uint64_t size;
+    FILETIME mtime;
+    platform_file_id_t id;
+    uint32_t link_count;
+    unsigned metadata;          // PLATFORM_METADATA_* fields that are loaded
+    bool is_directory;
+    bool is_symlink;
+} platform_dir_entry_t;
+
+#define PLATFORM_READDIR_WIDE_NAMES 0x1u
+
+// Fill up to max_entries; returns 0 at end of directory. Entries stay valid
+// until the next call that uses the same arena.
+size_t platform_readdir_batch(platform_dir_iter_t *iter, platform_dir_entry_t *entries,
+                              size_t max_entries, platform_name_arena_t *arena, unsigned flags);
+
+// Fill the requested PLATFORM_METADATA_* fields that the batch did not already
+// provide. Free on Windows; one statx relative to the open directory on Linux.
+bool platform_dir_entry_load_metadata(platform_dir_iter_t *iter, platform_dir_entry_t *entry, unsigned fields);
+
+// Optional batched I/O engine (io_uring on Linux 5.6+). create returns NULL when
+// the kernel or sandbox doesn't allow it; every batch call accepts a NULL
+// engine and falls back to one syscall per entry. Not thread-safe: one per worker.
+typedef struct platform_io_engine platform_io_engine_t;
+
+platform_io_engine_t* platform_io_engine_create(unsigned queue_depth);
+void platform_io_engine_destroy(platform_io_engine_t *engine);
+
+void platform_dir_entries_load_metadata(platform_io_engine_t *engine, platform_dir_iter_t *iter,
+                                        platform_dir_entry_t **entries, size_t count, unsigned fields);
+
+// out[i] is NULL where names[i] could not be opened
+void platform_opendir_at_batch(platform_io_engine_t *engine, platform_dir_iter_t *parent,
+                               const char **names, platform_dir_iter_t **out, size_t count);
+
 #endif
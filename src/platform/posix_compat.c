@@ -0,0 +1,73 @@
+#include "compat.h"
+
+// Only non-Windows builds compile this file; the guard keeps a stray Windows build harmless
+#ifndef _WIN32
+
+// Howard Hinnant's civil-date algorithms, proleptic Gregorian, UTC
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void civil_from_days(int64_t z, int64_t *y, unsigned *m, unsigned *d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int64_t)yoe + era * 400 + (*m <= 2);
+}
+
+BOOL SystemTimeToFileTime(const SYSTEMTIME *st, FILETIME *ft) {
+    if (!st || !ft) return FALSE;
+    if (st->wMonth < 1 || st->wMonth > 12 || st->wDay < 1 || st->wDay > 31 ||
+        st->wHour > 23 || st->wMinute > 59 || st->wSecond > 59 || st->wMilliseconds > 999) {
+        return FALSE;
+    }
+
+    int64_t days = days_from_civil(st->wYear, st->wMonth, st->wDay);
+    int64_t secs = days * 86400 + st->wHour * 3600 + st->wMinute * 60 + st->wSecond;
+    *ft = compat_timespec_to_filetime(secs, (long)st->wMilliseconds * 1000000L);
+    return TRUE;
+}
+
+BOOL FileTimeToSystemTime(const FILETIME *ft, SYSTEMTIME *st) {
+    if (!ft || !st) return FALSE;
+
+    int64_t ticks = (int64_t)(compat_filetime_to_u64(ft) - COMPAT_EPOCH_DIFF_100NS);
+    int64_t secs = ticks / 10000000;
+    int64_t rem = ticks % 10000000;
+    if (rem < 0) {
+        rem += 10000000;
+        secs--;
+    }
+    int64_t days = secs / 86400;
+    int64_t sod = secs % 86400;
+    if (sod < 0) {
+        sod += 86400;
+        days--;
+    }
+
+    int64_t y;
+    unsigned m, d;
+    civil_from_days(days, &y, &m, &d);
+
+    st->wYear = (WORD)y;
+    st->wMonth = (WORD)m;
+    st->wDay = (WORD)d;
+    st->wDayOfWeek = (WORD)((days + 4) % 7 < 0 ? (days + 4) % 7 + 7 : (days + 4) % 7);
+    st->wHour = (WORD)(sod / 3600);
+    st->wMinute = (WORD)((sod % 3600) / 60);
+    st->wSecond = (WORD)(sod % 60);
+    st->wMilliseconds = (WORD)(rem / 10000);
+    return TRUE;
+}
+
+#endif
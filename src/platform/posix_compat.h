@@ -0,0 +1,105 @@
+#ifndef POSIX_COMPAT_H
+#define POSIX_COMPAT_H
+
+// The subset of the Win32 API that fq's core and CLI still use, mapped onto
+// POSIX: base types, FILETIME and the date helpers. Threads and locks live
+// in threading.h.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+typedef uint32_t DWORD;
+typedef long LONG;
+typedef int BOOL;
+typedef uint16_t WORD;
+typedef int32_t HRESULT;
+typedef void *HANDLE;
+typedef void *LPVOID;
+
+#ifndef TRUE
+    #define TRUE 1
+#endif
+#ifndef FALSE
+    #define FALSE 0
+#endif
+
+#define WINAPI
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFFu
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define ERROR_INSUFFICIENT_BUFFER 122
+#define HRESULT_FROM_WIN32(x) ((HRESULT)(((x) & 0x0000FFFF) | 0x80070000))
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+#define FILE_ATTRIBUTE_DIRECTORY 0x10u
+
+#define _isatty isatty
+#define _fileno fileno
+
+typedef struct {
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct {
+    WORD wYear;
+    WORD wMonth;
+    WORD wDayOfWeek;
+    WORD wDay;
+    WORD wHour;
+    WORD wMinute;
+    WORD wSecond;
+    WORD wMilliseconds;
+} SYSTEMTIME;
+
+// 100ns intervals between 1601-01-01 and 1970-01-01
+#define COMPAT_EPOCH_DIFF_100NS 116444736000000000ULL
+
+static inline uint64_t compat_filetime_to_u64(const FILETIME *ft) {
+    return ((uint64_t)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+static inline FILETIME compat_u64_to_filetime(uint64_t value) {
+    FILETIME ft = { (DWORD)(value & 0xFFFFFFFFu), (DWORD)(value >> 32) };
+    return ft;
+}
+
+static inline FILETIME compat_timespec_to_filetime(int64_t sec, long nsec) {
+    uint64_t ticks = (uint64_t)(sec * 10000000LL + nsec / 100) + COMPAT_EPOCH_DIFF_100NS;
+    return compat_u64_to_filetime(ticks);
+}
+
+static inline LONG CompareFileTime(const FILETIME *a, const FILETIME *b) {
+    uint64_t va = compat_filetime_to_u64(a);
+    uint64_t vb = compat_filetime_to_u64(b);
+    return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+BOOL SystemTimeToFileTime(const SYSTEMTIME *st, FILETIME *ft);
+BOOL FileTimeToSystemTime(const FILETIME *ft, SYSTEMTIME *st);
+
+static inline DWORD CharLowerBuffA(char *str, DWORD len) {
+    for (DWORD i = 0; i < len; i++) {
+        str[i] = (char)tolower((unsigned char)str[i]);
+    }
+    return len;
+}
+
+static inline DWORD GetFileAttributesA(const char *path) {
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return INVALID_FILE_ATTRIBUTES;
+    return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : 0;
+}
+
+#endif
@@ -0,0 +1,290 @@
+#include "slab.h"
+#include "threading.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define SLAB_CLASS_COUNT 4
+#define SLAB_CHUNK_OBJECTS 64
+#define SLAB_REMOTE_BATCH 32
+#define SLAB_OUTGOING_SLOTS 8
+#define SLAB_HEAP_CLASS UINT32_MAX
+
+// Payload bytes per class; anything larger goes to malloc
+static const size_t slab_class_sizes[SLAB_CLASS_COUNT] = { 64, 128, 256, 512 };
+
+// 16 bytes, so payloads keep malloc's alignment
+typedef struct slab_header {
+    slab_cache_t *owner;    // NULL for plain heap blocks
+    uint32_t size_class;
+    uint32_t reserved;
+} slab_header_t;
+
+typedef struct slab_chunk {
+    struct slab_chunk *next;
+    void *reserved;         // keeps the objects that follow 16-byte aligned
+} slab_chunk_t;
+
+// Remote frees waiting to go back to one owner
+typedef struct {
+    slab_cache_t *owner;
+    slab_header_t *head;
+    slab_header_t *tail;
+    size_t count;
+} slab_outgoing_t;
+
+struct slab_cache {
+    slab_t *slab;
+    slab_header_t *free_lists[SLAB_CLASS_COUNT];
+    char *bump[SLAB_CLASS_COUNT];           // uncarved rest of the newest chunk
+    size_t bump_left[SLAB_CLASS_COUNT];
+    _Atomic(slab_header_t*) inbox;          // pushed by other threads, drained by the owner
+    slab_outgoing_t outgoing[SLAB_OUTGOING_SLOTS];
+    struct slab_cache *next_cache;
+
+    // Written by the owner only; atomic so stats can be read while running
+    atomic_size_t reused;
+    atomic_size_t carved;
+    atomic_size_t heap_allocs;
+    atomic_size_t remote_frees;
+    atomic_size_t remote_batches;
+};
+
+struct slab {
+    platform_mutex_t lock;      // chunk and cache lists; taken once per chunk
+    slab_chunk_t *chunks;
+    slab_cache_t *caches;
+
+    // Traffic from threads without a cache
+    atomic_size_t heap_allocs;
+    atomic_size_t remote_frees;
+};
+
+// Free objects link through their first payload word
+static slab_header_t** slab_link(slab_header_t *header) {
+    return (slab_header_t**)(void*)(header + 1);
+}
+
+static int slab_class_for(size_t size) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        if (size <= slab_class_sizes[i]) return i;
+    }
+    return -1;
+}
+
+// Shared counters: any thread without a cache may bump these
+static void slab_counter_add(atomic_size_t *counter, size_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+// Per-cache counters have one writer, so a plain load and store will do
+// and the hot path takes no locked instruction
+static void slab_cache_counter_add(atomic_size_t *counter, size_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+slab_t* slab_create(void) {
+    slab_t *slab = (slab_t*)calloc(1, sizeof(slab_t));
+    if (!slab) return NULL;
+
+    platform_mutex_init(&slab->lock);
+    atomic_init(&slab->heap_allocs, 0);
+    atomic_init(&slab->remote_frees, 0);
+    return slab;
+}
+
+void slab_destroy(slab_t *slab) {
+    if (!slab) return;
+
+    slab_chunk_t *chunk = slab->chunks;
+    while (chunk) {
+        slab_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    slab_cache_t *cache = slab->caches;
+    while (cache) {
+        slab_cache_t *next = cache->next_cache;
+        free(cache);
+        cache = next;
+    }
+
+    platform_mutex_destroy(&slab->lock);
+    free(slab);
+}
+
+slab_cache_t* slab_cache_create(slab_t *slab) {
+    if (!slab) return NULL;
+
+    slab_cache_t *cache = (slab_cache_t*)calloc(1, sizeof(slab_cache_t));
+    if (!cache) return NULL;
+
+    cache->slab = slab;
+    atomic_init(&cache->inbox, NULL);
+    atomic_init(&cache->reused, 0);
+    atomic_init(&cache->carved, 0);
+    atomic_init(&cache->heap_allocs, 0);
+    atomic_init(&cache->remote_frees, 0);
+    atomic_init(&cache->remote_batches, 0);
+
+    platform_mutex_lock(&slab->lock);
+    cache->next_cache = slab->caches;
+    slab->caches = cache;
+    platform_mutex_unlock(&slab->lock);
+    return cache;
+}
+
+static void slab_inbox_push(slab_cache_t *owner, slab_header_t *head, slab_header_t *tail) {
+    slab_header_t *old = atomic_load_explicit(&owner->inbox, memory_order_relaxed);
+    do {
+        *slab_link(tail) = old;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->inbox, &old, head,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// The owner takes the whole inbox at once, so pushers never race a pop
+static void slab_inbox_drain(slab_cache_t *cache) {
+    slab_header_t *header = atomic_exchange_explicit(&cache->inbox, NULL, memory_order_acquire);
+    while (header) {
+        slab_header_t *next = *slab_link(header);
+        *slab_link(header) = cache->free_lists[header->size_class];
+        cache->free_lists[header->size_class] = header;
+        header = next;
+    }
+}
+
+static void slab_outgoing_flush(slab_cache_t *cache, slab_outgoing_t *out) {
+    if (out->count == 0) return;
+
+    slab_inbox_push(out->owner, out->head, out->tail);
+    slab_cache_counter_add(&cache->remote_batches, 1);
+    out->owner = NULL;
+    out->head = NULL;
+    out->tail = NULL;
+    out->count = 0;
+}
+
+void slab_cache_flush(slab_cache_t *cache) {
+    if (!cache) return;
+
+    for (size_t i = 0; i < SLAB_OUTGOING_SLOTS; i++) {
+        slab_outgoing_flush(cache, &cache->outgoing[i]);
+    }
+}
+
+static bool slab_cache_new_chunk(slab_cache_t *cache, int size_class) {
+    size_t stride = sizeof(slab_header_t) + slab_class_sizes[size_class];
+    slab_chunk_t *chunk = (slab_chunk_t*)malloc(sizeof(slab_chunk_t) + stride * SLAB_CHUNK_OBJECTS);
+    if (!chunk) return false;
+
+    slab_t *slab = cache->slab;
+    platform_mutex_lock(&slab->lock);
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+    platform_mutex_unlock(&slab->lock);
+
+    cache->bump[size_class] = (char*)(chunk + 1);
+    cache->bump_left[size_class] = SLAB_CHUNK_OBJECTS;
+    return true;
+}
+
+void* slab_alloc(slab_t *slab, slab_cache_t *cache, size_t size) {
+    int size_class = slab_class_for(size);
+
+    if (!cache || size_class < 0) {
+        slab_header_t *header = (slab_header_t*)malloc(sizeof(slab_header_t) + size);
+        if (!header) return NULL;
+        header->owner = NULL;
+        header->size_class = SLAB_HEAP_CLASS;
+        if (cache) {
+            slab_cache_counter_add(&cache->heap_allocs, 1);
+        } else {
+            slab_counter_add(&slab->heap_allocs, 1);
+        }
+        return header + 1;
+    }
+
+    slab_header_t *header = cache->free_lists[size_class];
+    if (!header) {
+        slab_inbox_drain(cache);
+        header = cache->free_lists[size_class];
+    }
+    if (header) {
+        cache->free_lists[size_class] = *slab_link(header);
+        slab_cache_counter_add(&cache->reused, 1);
+        return header + 1;
+    }
+
+    if (cache->bump_left[size_class] == 0 && !slab_cache_new_chunk(cache, size_class)) {
+        return NULL;
+    }
+    header = (slab_header_t*)(void*)cache->bump[size_class];
+    cache->bump[size_class] += sizeof(slab_header_t) + slab_class_sizes[size_class];
+    cache->bump_left[size_class]--;
+    header->owner = cache;
+    header->size_class = (uint32_t)size_class;
+    slab_cache_counter_add(&cache->carved, 1);
+    return header + 1;
+}
+
+void slab_free(slab_t *slab, slab_cache_t *cache, void *ptr) {
+    if (!ptr) return;
+
+    slab_header_t *header = (slab_header_t*)ptr - 1;
+    slab_cache_t *owner = header->owner;
+
+    if (!owner) {
+        free(header);
+        return;
+    }
+
+    if (owner == cache) {
+        *slab_link(header) = cache->free_lists[header->size_class];
+        cache->free_lists[header->size_class] = header;
+        return;
+    }
+
+    if (!cache) {
+        slab_inbox_push(owner, header, header);
+        slab_counter_add(&slab->remote_frees, 1);
+        return;
+    }
+
+    // Queue for the owner; a slot holds one owner at a time
+    slab_cache_counter_add(&cache->remote_frees, 1);
+    slab_outgoing_t *out = &cache->outgoing[((uintptr_t)owner >> 6) % SLAB_OUTGOING_SLOTS];
+    if (out->count > 0 && out->owner != owner) {
+        slab_outgoing_flush(cache, out);
+    }
+
+    *slab_link(header) = out->head;
+    out->head = header;
+    if (!out->tail) {
+        out->tail = header;
+    }
+    out->owner = owner;
+    if (++out->count >= SLAB_REMOTE_BATCH) {
+        slab_outgoing_flush(cache, out);
+    }
+}
+
+void slab_get_stats(slab_t *slab, slab_stats_t *stats) {
+    if (!slab || !stats) return;
+
+    stats->reused = 0;
+    stats->carved = 0;
+    stats->heap_allocs = atomic_load_explicit(&slab->heap_allocs, memory_order_relaxed);
+    stats->remote_frees = atomic_load_explicit(&slab->remote_frees, memory_order_relaxed);
+    stats->remote_batches = 0;
+
+    platform_mutex_lock(&slab->lock);
+    for (slab_cache_t *cache = slab->caches; cache; cache = cache->next_cache) {
+        stats->reused += atomic_load_explicit(&cache->reused, memory_order_relaxed);
+        stats->carved += atomic_load_explicit(&cache->carved, memory_order_relaxed);
+        stats->heap_allocs += atomic_load_explicit(&cache->heap_allocs, memory_order_relaxed);
+        stats->remote_frees += atomic_load_explicit(&cache->remote_frees, memory_order_relaxed);
+        stats->remote_batches += atomic_load_explicit(&cache->remote_batches, memory_order_relaxed);
+    }
+    platform_mutex_unlock(&slab->lock);
+}
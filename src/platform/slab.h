@@ -0,0 +1,41 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "compat.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size-class object caches for short-lived, fixed-size objects that are
+// allocated on one thread and often freed on another.
+//
+// Each thread allocates through its own slab_cache_t without locking. An
+// object freed by a thread other than its owner is queued locally and
+// handed back to the owner in batches through a lock-free inbox. All chunk
+// memory belongs to the slab_t and is released in one go by slab_destroy.
+typedef struct slab slab_t;
+typedef struct slab_cache slab_cache_t;
+
+typedef struct {
+    size_t reused;          // allocations served from a free list
+    size_t carved;          // objects cut from freshly allocated chunks
+    size_t heap_allocs;     // too large, or no cache: plain malloc
+    size_t remote_frees;    // freed by a thread other than the owner
+    size_t remote_batches;  // batches handed back to owners
+} slab_stats_t;
+
+slab_t* slab_create(void);
+// Releases every chunk; objects still allocated from it become invalid
+void slab_destroy(slab_t *slab);
+
+// Caches live until slab_destroy; one per thread, never shared
+slab_cache_t* slab_cache_create(slab_t *slab);
+// Hand queued remote frees back to their owners now (e.g. before idling)
+void slab_cache_flush(slab_cache_t *cache);
+
+// cache may be NULL (threads without one): falls back to malloc/free
+void* slab_alloc(slab_t *slab, slab_cache_t *cache, size_t size);
+void slab_free(slab_t *slab, slab_cache_t *cache, void *ptr);
+
+void slab_get_stats(slab_t *slab, slab_stats_t *stats);
+
+#endif
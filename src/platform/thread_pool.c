@@ -1,85 +1,990 @@
 #include "thread_pool.h"
-#include <windows.h>
+#include "slab.h"
+#include "threading.h"
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define THREAD_POOL_TLS __declspec(thread)
+#else
+    #define THREAD_POOL_TLS _Thread_local
+#endif
+
+#define THREAD_POOL_MIN_DEQUE_CAPACITY 256
+#define THREAD_POOL_MAX_DEVICES 64
+#define THREAD_POOL_STEAL_ROUNDS 4
+#define THREAD_POOL_PROGRESS_INTERVAL_MS 50
+#define THREAD_POOL_SPIN_ROUNDS 16
+#define THREAD_POOL_SPIN_PAUSES 64
+#define THREAD_POOL_TUNE_WINDOW_MS 100
+#define THREAD_POOL_TUNE_TOLERANCE 0.05     // smaller rate changes count as noise
+#define THREAD_POOL_TUNE_HOLD_WINDOWS 5     // flat windows before probing again
+#define THREAD_POOL_ADAPTIVE_MAX_THREADS 64 // caps oversubscription, not one per core
+#define THREAD_POOL_PRIORITY_LEVELS 64     // deeper priorities share the last level
+
+typedef struct device_slot device_slot_t;
 
 typedef struct work_item {
     work_function_t work_func;
     void *user_data;
-    struct work_item *next;
+    device_slot_t *device;
+    unsigned int priority;      // THREAD_POOL_ORDER_PRIORITY only
+    struct work_item *next;     // injection queue / priority levels / parked list only
 } work_item_t;
 
+// Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13 C11 version).
+// The owner pushes and pops at the bottom; thieves take from the top.
+// Outgrown buffers stay allocated until the pool is destroyed, since a
+// thief may still be reading one.
+typedef struct deque_buffer {
+    long long capacity;     // power of two
+    struct deque_buffer *prev;
+    _Atomic(work_item_t*) slots[];
+} deque_buffer_t;
+
+typedef struct {
+    atomic_llong top;
+    atomic_llong bottom;
+    _Atomic(deque_buffer_t*) buffer;
+} work_deque_t;
+
+// An idle worker parks on its own word; a waker claims it with
+// PARKED -> NOTIFIED before signalling, so each park gets one wakeup.
+// RETIRED workers are above the tuned worker count and ignore new work.
+enum { WORKER_RUNNING, WORKER_PARKED, WORKER_NOTIFIED, WORKER_RETIRED };
+
+typedef struct {
+    thread_pool_t *pool;
+    size_t index;
+    work_deque_t deque;
+    slab_cache_t *cache;    // work items and pool objects allocated here
+    atomic_uint park_state; // also the word parked workers wait on
+    uint32_t rng;           // victim selection
+    int cpu;                // pinned processor, or -1
+    uint32_t node;          // NUMA node of cpu; thieves try their own node first
+    // Written by the owner only; atomic so stats can be read while running
+    atomic_uint_least64_t busy_ns;
+    atomic_uint_least64_t idle_ns;
+    atomic_size_t steals;
+    char pad[64];           // keep neighbouring deques off this cache line
+} thread_pool_worker_t;
+
+// Per-device throttle. The counters are lock-free; items only touch the
+// parked list (and park_lock) when their device is already at its limit.
+enum { DEVICE_SLOT_FREE, DEVICE_SLOT_CLAIMING, DEVICE_SLOT_READY };
+
+struct device_slot {
+    atomic_int state;
+    uint64_t device;
+    atomic_size_t outstanding;  // submitted and not finished
+    atomic_size_t in_flight;
+    atomic_size_t parked;
+    work_item_t *parked_head;
+    work_item_t *parked_tail;
+};
+
+// Hill climbing over the worker count: keep stepping the way that last
+// raised throughput, turn around when a step lowered it
+typedef struct {
+    uint64_t last_tick;
+    size_t last_count;
+    double last_rate;
+    int direction;          // +1 grow, -1 shrink
+    int flat_windows;
+} thread_pool_tuner_t;
+
 struct thread_pool {
-    HANDLE *threads;
-    size_t thread_count;
+    platform_thread_t *threads;
+    thread_pool_worker_t *workers;
+    size_t thread_count;            // worker slots; the ceiling when adaptive
+    size_t started_count;           // only create and the monitor thread grow this
+    atomic_size_t active_limit;     // workers at or above this index retire
+    thread_pool_tuner_t tuner;      // monitor thread only
+    size_t numa_nodes;              // distinct worker nodes; 1 unless pinned
+
+    slab_t *slab;
+
+    // External submits (not from a worker thread) land here
+    platform_mutex_t inject_lock;
+    work_item_t *inject_head;
+    work_item_t *inject_tail;
+    atomic_size_t injected;
+
+    // THREAD_POOL_ORDER_PRIORITY: every item goes through one shared queue
+    // so the lowest priority anywhere runs next
+    platform_mutex_t priority_lock;
+    work_item_t *priority_heads[THREAD_POOL_PRIORITY_LEVELS];
+    work_item_t *priority_tails[THREAD_POOL_PRIORITY_LEVELS];
+    size_t priority_lowest;         // no items below this level
+    atomic_size_t prioritized;
+
+    device_slot_t devices[THREAD_POOL_MAX_DEVICES];
+    atomic_size_t busy_devices;     // devices with outstanding work
+    platform_mutex_t park_lock;
 
-    CRITICAL_SECTION queue_lock;
-    work_item_t *queue_head;
-    work_item_t *queue_tail;
-    HANDLE work_semaphore;
-    HANDLE done_event;
-    bool shutdown_requested;
+    atomic_size_t sleepers;         // parked workers not yet claimed by a waker
+    size_t spin_rounds;             // 0 on a single CPU, where spinning only delays others
+    atomic_size_t parks;
+    atomic_size_t wakeups;
+    platform_event_t done_event;    // set when pending_work_items drops to zero
+    atomic_bool shutdown;
 
-    size_t active_work_items;
-    size_t completed_work_items;
-    size_t total_submitted;
-    size_t queued_work_items;
+    // Progress reports and worker-count tuning run on a monitor thread,
+    // started by the first wait that outlasts one interval. progress_cb
+    // only runs while someone is waiting.
+    uint32_t monitor_interval;
+    bool monitor_started;
+    bool monitor_running;
+    platform_thread_t monitor_thread;
+    platform_event_t monitor_stop_event;
+    platform_mutex_t progress_lock;
+    bool progress_waiting;
+    atomic_bool progress_cancelled;     // progress_cb asked to stop
+
+    atomic_size_t pending_work_items;   // submitted and not finished
+    atomic_size_t active_work_items;
+    atomic_size_t completed_work_items;
+    atomic_size_t total_submitted;
+    atomic_size_t inline_work_items;
 
     thread_pool_config_t config;
 };
 
-static DWORD WINAPI thread_pool_worker(LPVOID param) {
-    thread_pool_t *pool = (thread_pool_t*)param;
+static THREAD_POOL_TLS thread_pool_worker_t *current_worker;
+
+// Owner-only counters: a plain load and store, no locked add
+static void worker_add_time(atomic_uint_least64_t *counter, uint64_t start, uint64_t end) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + (end - start),
+                          memory_order_relaxed);
+}
+
+static deque_buffer_t* deque_buffer_create(long long capacity, deque_buffer_t *prev) {
+    deque_buffer_t *buffer = (deque_buffer_t*)malloc(sizeof(deque_buffer_t) +
+                                                     (size_t)capacity * sizeof(_Atomic(work_item_t*)));
+    if (!buffer) return NULL;
+    buffer->capacity = capacity;
+    buffer->prev = prev;
+    return buffer;
+}
+
+static bool deque_init(work_deque_t *deque, long long capacity) {
+    deque_buffer_t *buffer = deque_buffer_create(capacity, NULL);
+    if (!buffer) return false;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->buffer, buffer);
+    return true;
+}
+
+static void work_item_drop(slab_t *slab, work_release_t release, work_item_t *item) {
+    if (release) {
+        release(item->user_data);
+    }
+    slab_free(slab, NULL, item);
+}
+
+static void deque_destroy(work_deque_t *deque, slab_t *slab, work_release_t release) {
+    deque_buffer_t *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    for (long long i = top; i < bottom; i++) {
+        work_item_drop(slab, release, atomic_load_explicit(&buffer->slots[i & (buffer->capacity - 1)],
+                                                           memory_order_relaxed));
+    }
+    while (buffer) {
+        deque_buffer_t *prev = buffer->prev;
+        free(buffer);
+        buffer = prev;
+    }
+}
+
+// Owner only: copy the queued items into a new buffer allocated by the
+// calling thread; the old one stays on the prev chain for late thieves
+static bool deque_resize(work_deque_t *deque, long long capacity) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    deque_buffer_t *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+
+    deque_buffer_t *resized = deque_buffer_create(capacity, buffer);
+    if (!resized) return false;
+    for (long long i = top; i < bottom; i++) {
+        atomic_store_explicit(&resized->slots[i & (resized->capacity - 1)],
+                              atomic_load_explicit(&buffer->slots[i & (buffer->capacity - 1)],
+                                                   memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+    atomic_store_explicit(&deque->buffer, resized, memory_order_release);
+    return true;
+}
+
+// Owner only
+static bool deque_push(work_deque_t *deque, work_item_t *item) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    deque_buffer_t *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+
+    if (bottom - top > buffer->capacity - 1) {
+        if (!deque_resize(deque, buffer->capacity * 2)) return false;
+        buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&buffer->slots[bottom & (buffer->capacity - 1)], item, memory_order_relaxed);
+    // Publishes the item to thieves that acquire-load bottom
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+// Owner only; LIFO, so a worker keeps descending into what it just found
+static work_item_t* deque_pop(work_deque_t *deque) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    deque_buffer_t *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    work_item_t *item = atomic_load_explicit(&buffer->slots[bottom & (buffer->capacity - 1)],
+                                             memory_order_relaxed);
+    if (top == bottom) {
+        // Last item: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            item = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return item;
+}
 
+typedef enum { STEAL_EMPTY, STEAL_ABORT, STEAL_SUCCESS } steal_result_t;
+
+// Any thread; FIFO, so thieves take the oldest (usually largest) subtree
+static steal_result_t deque_steal(work_deque_t *deque, work_item_t **item) {
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) return STEAL_EMPTY;
+
+    deque_buffer_t *buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+    work_item_t *candidate = atomic_load_explicit(&buffer->slots[top & (buffer->capacity - 1)],
+                                                  memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return STEAL_ABORT;
+    }
+    *item = candidate;
+    return STEAL_SUCCESS;
+}
+
+// Owner taking its own oldest item (THREAD_POOL_ORDER_FIFO); competes with thieves
+static work_item_t* deque_take_oldest(work_deque_t *deque) {
+    work_item_t *item;
     for (;;) {
-        if (pool->config.stop_flag && atomic_load(pool->config.stop_flag)) {
-            break;
+        steal_result_t result = deque_steal(deque, &item);
+        if (result == STEAL_SUCCESS) return item;
+        if (result == STEAL_EMPTY) return NULL;
+    }
+}
+
+static uint64_t device_hash(uint64_t device) {
+    device ^= device >> 33;
+    device *= 0xff51afd7ed558ccdULL;
+    device ^= device >> 33;
+    return device;
+}
+
+// Lock-free lookup/insert; past THREAD_POOL_MAX_DEVICES devices share slots
+static device_slot_t* device_slot_for(thread_pool_t *pool, uint64_t device) {
+    size_t start = (size_t)(device_hash(device) % THREAD_POOL_MAX_DEVICES);
+
+    for (size_t n = 0; n < THREAD_POOL_MAX_DEVICES; n++) {
+        device_slot_t *slot = &pool->devices[(start + n) % THREAD_POOL_MAX_DEVICES];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        if (state == DEVICE_SLOT_FREE) {
+            if (atomic_compare_exchange_strong(&slot->state, &state, DEVICE_SLOT_CLAIMING)) {
+                slot->device = device;
+                atomic_store_explicit(&slot->state, DEVICE_SLOT_READY, memory_order_release);
+                return slot;
+            }
         }
+        while (state == DEVICE_SLOT_CLAIMING) {
+            state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        }
+        if (slot->device == device) {
+            return slot;
+        }
+    }
+    return &pool->devices[start];
+}
 
-        DWORD wait_result = WaitForSingleObject(pool->work_semaphore, INFINITE);
-        if (wait_result != WAIT_OBJECT_0) {
-            break;
+static size_t device_limit(thread_pool_t *pool) {
+    if (pool->config.per_device_limit > 0) {
+        return pool->config.per_device_limit;
+    }
+    // Share the workers across the devices that currently have work
+    size_t busy = atomic_load(&pool->busy_devices);
+    if (busy == 0) busy = 1;
+    size_t workers = atomic_load(&pool->active_limit);
+    return (workers + busy - 1) / busy;
+}
+
+static bool device_try_acquire(thread_pool_t *pool, device_slot_t *slot) {
+    size_t limit = device_limit(pool);
+    size_t in_flight = atomic_load(&slot->in_flight);
+    while (in_flight < limit) {
+        if (atomic_compare_exchange_strong(&slot->in_flight, &in_flight, in_flight + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sleep while park_state still holds state
+static void worker_park_wait(thread_pool_worker_t *worker, unsigned int state) {
+    while (atomic_load(&worker->park_state) == state) {
+        platform_wait_on_address(&worker->park_state, state, PLATFORM_WAIT_INFINITE);
+    }
+}
+
+static void worker_park_signal(thread_pool_worker_t *worker) {
+    platform_wake_address_one(&worker->park_state);
+}
+
+static void thread_pool_cpu_relax(void) {
+#if defined(_MSC_VER)
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Workers that never started stay RUNNING, so scanning the slots is safe
+static bool thread_pool_unpark_one(thread_pool_t *pool) {
+    size_t limit = atomic_load(&pool->active_limit);
+    for (size_t i = 0; i < limit; i++) {
+        thread_pool_worker_t *worker = &pool->workers[i];
+        unsigned int state = WORKER_PARKED;
+        if (atomic_compare_exchange_strong(&worker->park_state, &state, WORKER_NOTIFIED)) {
+            atomic_fetch_sub(&pool->sleepers, 1);
+            atomic_fetch_add_explicit(&pool->wakeups, 1, memory_order_relaxed);
+            worker_park_signal(worker);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void thread_pool_wake(thread_pool_t *pool, size_t count) {
+    // Pairs with the parker's announce-then-rescan: either it sees our
+    // push, or we see it parked
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // A waker takes a parked worker off the count as it claims it, so a
+    // burst of submits wakes each idle worker once and then costs one load
+    while (count > 0 && atomic_load(&pool->sleepers) > 0) {
+        if (!thread_pool_unpark_one(pool)) break;
+        count--;
+    }
+}
+
+static void thread_pool_inject(thread_pool_t *pool, work_item_t *item) {
+    platform_mutex_lock(&pool->inject_lock);
+    if (pool->inject_tail) {
+        pool->inject_tail->next = item;
+    } else {
+        pool->inject_head = item;
+    }
+    pool->inject_tail = item;
+    atomic_fetch_add(&pool->injected, 1);
+    platform_mutex_unlock(&pool->inject_lock);
+}
+
+static void priority_push(thread_pool_t *pool, work_item_t *item) {
+    size_t level = item->priority < THREAD_POOL_PRIORITY_LEVELS ? item->priority
+                                                                : THREAD_POOL_PRIORITY_LEVELS - 1;
+    item->next = NULL;
+
+    platform_mutex_lock(&pool->priority_lock);
+    if (pool->priority_tails[level]) {
+        pool->priority_tails[level]->next = item;
+    } else {
+        pool->priority_heads[level] = item;
+    }
+    pool->priority_tails[level] = item;
+    if (level < pool->priority_lowest) {
+        pool->priority_lowest = level;
+    }
+    atomic_fetch_add(&pool->prioritized, 1);
+    platform_mutex_unlock(&pool->priority_lock);
+}
+
+static work_item_t* priority_pop(thread_pool_t *pool) {
+    if (atomic_load(&pool->prioritized) == 0) return NULL;
+
+    work_item_t *item = NULL;
+    platform_mutex_lock(&pool->priority_lock);
+    while (pool->priority_lowest < THREAD_POOL_PRIORITY_LEVELS &&
+           !pool->priority_heads[pool->priority_lowest]) {
+        pool->priority_lowest++;
+    }
+    if (pool->priority_lowest < THREAD_POOL_PRIORITY_LEVELS) {
+        size_t level = pool->priority_lowest;
+        item = pool->priority_heads[level];
+        pool->priority_heads[level] = item->next;
+        if (!pool->priority_heads[level]) {
+            pool->priority_tails[level] = NULL;
+        }
+        atomic_fetch_sub(&pool->prioritized, 1);
+        item->next = NULL;
+    }
+    platform_mutex_unlock(&pool->priority_lock);
+    return item;
+}
+
+// Queue an item where this pool's order looks first; worker is the
+// calling worker, or NULL from outside the pool. A worker the tuner is
+// retiring is no longer stolen from, so its items go to the shared list.
+static void thread_pool_enqueue(thread_pool_t *pool, thread_pool_worker_t *worker, work_item_t *item) {
+    if (pool->config.order == THREAD_POOL_ORDER_PRIORITY) {
+        priority_push(pool, item);
+    } else if (!worker || worker->index >= atomic_load_explicit(&pool->active_limit, memory_order_relaxed) ||
+               !deque_push(&worker->deque, item)) {
+        thread_pool_inject(pool, item);
+    }
+}
+
+// Move parked items the device has room for back into the queue; they
+// acquire their slot again when taken
+static void device_unpark(thread_pool_t *pool, thread_pool_worker_t *worker, device_slot_t *slot) {
+    if (atomic_load(&slot->parked) == 0) return;
+
+    size_t limit = device_limit(pool);
+    size_t moved = 0;
+
+    platform_mutex_lock(&pool->park_lock);
+    size_t in_flight = atomic_load(&slot->in_flight);
+    size_t room = in_flight < limit ? limit - in_flight : 0;
+    while (room > 0 && slot->parked_head) {
+        work_item_t *item = slot->parked_head;
+        slot->parked_head = item->next;
+        if (!slot->parked_head) {
+            slot->parked_tail = NULL;
+        }
+        atomic_fetch_sub(&slot->parked, 1);
+        item->next = NULL;
+        thread_pool_enqueue(pool, worker, item);
+        room--;
+        moved++;
+    }
+    platform_mutex_unlock(&pool->park_lock);
+
+    thread_pool_wake(pool, moved);
+}
+
+// The device is at its limit: hold the item until one of its running items
+// finishes. Returns an item that may run right away (holding a slot) if
+// the device freed up meanwhile.
+static work_item_t* device_park(thread_pool_t *pool, work_item_t *item) {
+    device_slot_t *slot = item->device;
+
+    platform_mutex_lock(&pool->park_lock);
+    item->next = NULL;
+    if (slot->parked_tail) {
+        slot->parked_tail->next = item;
+    } else {
+        slot->parked_head = item;
+    }
+    slot->parked_tail = item;
+    atomic_fetch_add(&slot->parked, 1);
+    platform_mutex_unlock(&pool->park_lock);
+
+    // A release between our failed acquire and the append saw nothing parked
+    if (!device_try_acquire(pool, slot)) {
+        return NULL;
+    }
+
+    platform_mutex_lock(&pool->park_lock);
+    work_item_t *next = slot->parked_head;
+    if (next) {
+        slot->parked_head = next->next;
+        if (!slot->parked_head) {
+            slot->parked_tail = NULL;
+        }
+        atomic_fetch_sub(&slot->parked, 1);
+        next->next = NULL;
+    }
+    platform_mutex_unlock(&pool->park_lock);
+
+    if (!next) {
+        atomic_fetch_sub(&slot->in_flight, 1);
+    }
+    return next;
+}
+
+static void device_finish(thread_pool_t *pool, thread_pool_worker_t *worker, device_slot_t *slot) {
+    atomic_fetch_sub(&slot->in_flight, 1);
+
+    if (atomic_fetch_sub(&slot->outstanding, 1) == 1) {
+        // One device fewer to share the workers: every other limit rises
+        atomic_fetch_sub(&pool->busy_devices, 1);
+        for (size_t i = 0; i < THREAD_POOL_MAX_DEVICES; i++) {
+            device_unpark(pool, worker, &pool->devices[i]);
+        }
+    } else {
+        device_unpark(pool, worker, slot);
+    }
+}
+
+static work_item_t* thread_pool_take_injected(thread_pool_t *pool) {
+    if (atomic_load(&pool->injected) == 0) return NULL;
+
+    platform_mutex_lock(&pool->inject_lock);
+    work_item_t *item = pool->inject_head;
+    if (item) {
+        pool->inject_head = item->next;
+        if (!pool->inject_head) {
+            pool->inject_tail = NULL;
+        }
+        atomic_fetch_sub(&pool->injected, 1);
+        item->next = NULL;
+    }
+    platform_mutex_unlock(&pool->inject_lock);
+    return item;
+}
+
+static work_item_t* thread_pool_find_work(thread_pool_worker_t *worker) {
+    thread_pool_t *pool = worker->pool;
+
+    if (pool->config.order == THREAD_POOL_ORDER_PRIORITY) {
+        return priority_pop(pool);
+    }
+
+    work_item_t *item = pool->config.order == THREAD_POOL_ORDER_FIFO ? deque_take_oldest(&worker->deque)
+                                                                      : deque_pop(&worker->deque);
+    if (item) return item;
+
+    item = thread_pool_take_injected(pool);
+    if (item) return item;
+
+    // Only running workers can hold work: slots the tuner has not started
+    // are empty, and a retiring worker hands its queue to the shared list
+    size_t victims = atomic_load_explicit(&pool->active_limit, memory_order_relaxed);
+    if (victims < 2) return NULL;
+
+    // xorshift32 picks where the victim scan starts, spreading thieves out.
+    // With workers on several nodes, each round scans our own node first,
+    // so directories (and the memory they touch) cross sockets last.
+    int passes = pool->numa_nodes > 1 ? 2 : 1;
+    for (int round = 0; round < THREAD_POOL_STEAL_ROUNDS; round++) {
+        worker->rng ^= worker->rng << 13;
+        worker->rng ^= worker->rng >> 17;
+        worker->rng ^= worker->rng << 5;
+
+        bool contended = false;
+        size_t start = worker->rng % victims;
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t n = 0; n < victims; n++) {
+                thread_pool_worker_t *victim = &pool->workers[(start + n) % victims];
+                if (victim == worker) continue;
+                if (passes > 1 && (victim->node == worker->node) != (pass == 0)) continue;
+
+                steal_result_t result = deque_steal(&victim->deque, &item);
+                if (result == STEAL_SUCCESS) {
+                    atomic_store_explicit(&worker->steals,
+                                          atomic_load_explicit(&worker->steals, memory_order_relaxed) + 1,
+                                          memory_order_relaxed);
+                    return item;
+                }
+                if (result == STEAL_ABORT) contended = true;
+            }
+        }
+        if (!contended) break;
+    }
+    return NULL;
+}
+
+static bool thread_pool_stopping(thread_pool_t *pool) {
+    return atomic_load(&pool->shutdown) ||
+           (pool->config.stop_flag && atomic_load(pool->config.stop_flag));
+}
+
+// A worker stepping aside passes its queue on rather than running it alone
+static void thread_pool_hand_off(thread_pool_worker_t *worker) {
+    size_t moved = 0;
+    work_item_t *item;
+    while ((item = deque_pop(&worker->deque)) != NULL) {
+        item->next = NULL;
+        thread_pool_inject(worker->pool, item);
+        moved++;
+    }
+    thread_pool_wake(worker->pool, moved);
+}
+
+static bool worker_above_limit(thread_pool_worker_t *worker) {
+    return worker->index >= atomic_load(&worker->pool->active_limit);
+}
+
+// The tuner lowered the worker count below us: sleep until it raises it
+// again (or the pool shuts down). Our deque is empty by now.
+static void thread_pool_retire(thread_pool_worker_t *worker) {
+    thread_pool_t *pool = worker->pool;
+
+    slab_cache_flush(worker->cache);
+    atomic_store(&worker->park_state, WORKER_RETIRED);
+    atomic_thread_fence(memory_order_seq_cst);
+    // Pairs with thread_pool_set_limit: it either sees us retired or we see the new limit
+    if (worker_above_limit(worker) && !atomic_load(&pool->shutdown)) {
+        worker_park_wait(worker, WORKER_RETIRED);
+    }
+    atomic_store(&worker->park_state, WORKER_RUNNING);
+}
+
+// Blocks until there is work; NULL once the pool is destroyed. A raised
+// stop_flag only refuses new submits: queued items still run (work
+// functions see the flag and return early) so pending drains to zero.
+static work_item_t* thread_pool_next_item(thread_pool_worker_t *worker) {
+    thread_pool_t *pool = worker->pool;
+    uint64_t idle_start = platform_tick_ns();
+    work_item_t *item;
+
+    for (;;) {
+        if (atomic_load(&pool->shutdown)) return NULL;
+
+        if (worker_above_limit(worker)) {
+            thread_pool_hand_off(worker);
+            worker_add_time(&worker->idle_ns, idle_start, platform_tick_ns());
+            thread_pool_retire(worker);
+            idle_start = platform_tick_ns();
+            continue;
         }
 
-        work_item_t *item = NULL;
-        EnterCriticalSection(&pool->queue_lock);
-        if (pool->queue_head) {
-            item = pool->queue_head;
-            pool->queue_head = item->next;
-            if (!pool->queue_head) {
-                pool->queue_tail = NULL;
+        item = thread_pool_find_work(worker);
+        if (item) goto found;
+
+        // New work usually turns up within microseconds of running dry
+        for (size_t round = 0; round < pool->spin_rounds; round++) {
+            for (int i = 0; i < THREAD_POOL_SPIN_PAUSES; i++) {
+                thread_pool_cpu_relax();
             }
-            if (pool->queued_work_items > 0) {
-                pool->queued_work_items--;
+            item = thread_pool_find_work(worker);
+            if (item) goto found;
+        }
+
+        // Remote frees queued here would otherwise wait out the sleep
+        slab_cache_flush(worker->cache);
+
+        // Announce the park, then look once more: a submit that raced with
+        // the scan above either sees the parked worker or is seen here
+        atomic_store(&worker->park_state, WORKER_PARKED);
+        atomic_fetch_add(&pool->sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        bool leave = atomic_load(&pool->shutdown) || worker_above_limit(worker);
+        item = leave ? NULL : thread_pool_find_work(worker);
+        if (item || leave) {
+            unsigned int state = WORKER_PARKED;
+            if (atomic_compare_exchange_strong(&worker->park_state, &state, WORKER_RUNNING)) {
+                atomic_fetch_sub(&pool->sleepers, 1);
+            } else {
+                // A waker claimed us meanwhile and already took us off the count
+                atomic_store(&worker->park_state, WORKER_RUNNING);
             }
-            pool->active_work_items++;
+            if (item) goto found;
+            continue;
         }
-        LeaveCriticalSection(&pool->queue_lock);
 
+        atomic_fetch_add_explicit(&pool->parks, 1, memory_order_relaxed);
+        worker_park_wait(worker, WORKER_PARKED);
+        atomic_store(&worker->park_state, WORKER_RUNNING);
+    }
+
+found:
+    worker_add_time(&worker->idle_ns, idle_start, platform_tick_ns());
+    return item;
+}
+
+static void thread_pool_worker(void *param) {
+    thread_pool_worker_t *worker = (thread_pool_worker_t*)param;
+    thread_pool_t *pool = worker->pool;
+    current_worker = worker;
+
+    // Pin before allocating anything, so first-touch places the worker's
+    // context, slab chunks and deque buffer on its own node
+    if (worker->cpu >= 0 && platform_thread_pin((uint32_t)worker->cpu)) {
+        deque_buffer_t *buffer = atomic_load_explicit(&worker->deque.buffer, memory_order_relaxed);
+        deque_resize(&worker->deque, buffer->capacity);
+    }
+
+    void *worker_context = NULL;
+    if (pool->config.worker_init) {
+        worker_context = pool->config.worker_init(pool->config.worker_user_data);
+    }
+
+    for (;;) {
+        work_item_t *item = thread_pool_next_item(worker);
         if (!item) {
-            continue;
+            break;
+        }
+
+        if (!device_try_acquire(pool, item->device)) {
+            item = device_park(pool, item);
+            if (!item) {
+                continue;
+            }
+        }
+
+        atomic_fetch_add(&pool->active_work_items, 1);
+        uint64_t busy_start = platform_tick_ns();
+        item->work_func(worker_context, item->user_data);
+        worker_add_time(&worker->busy_ns, busy_start, platform_tick_ns());
+        atomic_fetch_sub(&pool->active_work_items, 1);
+        atomic_fetch_add(&pool->completed_work_items, 1);
+
+        device_finish(pool, worker, item->device);
+        slab_free(pool->slab, worker->cache, item);
+
+        if (atomic_fetch_sub(&pool->pending_work_items, 1) == 1) {
+            platform_event_set(&pool->done_event);
+        }
+    }
+
+    if (pool->config.worker_cleanup) {
+        pool->config.worker_cleanup(worker_context, pool->config.worker_user_data);
+    }
+
+    current_worker = NULL;
+}
+
+static bool thread_pool_start_worker(thread_pool_t *pool, size_t index) {
+    return platform_thread_create(&pool->threads[index], thread_pool_worker, &pool->workers[index]);
+}
+
+// Monitor thread (or create) only
+static void thread_pool_set_limit(thread_pool_t *pool, size_t limit) {
+    // Threads above the old limit are started on first use
+    while (pool->started_count < limit) {
+        if (!thread_pool_start_worker(pool, pool->started_count)) {
+            limit = pool->started_count;
+            break;
         }
+        pool->started_count++;
+    }
 
-        item->work_func(NULL, item->user_data);
+    size_t old_limit = atomic_exchange(&pool->active_limit, limit);
+    atomic_thread_fence(memory_order_seq_cst);
 
-        EnterCriticalSection(&pool->queue_lock);
-        pool->completed_work_items++;
-        if (pool->active_work_items > 0) {
-            pool->active_work_items--;
+    if (limit > old_limit) {
+        for (size_t i = old_limit; i < limit; i++) {
+            unsigned int state = WORKER_RETIRED;
+            if (atomic_compare_exchange_strong(&pool->workers[i].park_state, &state, WORKER_RUNNING)) {
+                worker_park_signal(&pool->workers[i]);
+            }
         }
+    } else {
+        // Idle workers above the new limit wake up only to retire
+        for (size_t i = limit; i < old_limit; i++) {
+            unsigned int state = WORKER_PARKED;
+            if (atomic_compare_exchange_strong(&pool->workers[i].park_state, &state, WORKER_NOTIFIED)) {
+                atomic_fetch_sub(&pool->sleepers, 1);
+                worker_park_signal(&pool->workers[i]);
+            }
+        }
+    }
+}
+
+static size_t thread_pool_throughput_count(thread_pool_t *pool) {
+    return pool->config.throughput_counter ? atomic_load(pool->config.throughput_counter)
+                                           : atomic_load(&pool->completed_work_items);
+}
+
+// One hill-climbing step per window. Storage decides the best worker count
+// (a few for a spinning disk, many for NVMe, one per core for tmpfs), so it
+// is found by measurement rather than guessed from the core count.
+static void thread_pool_tune(thread_pool_t *pool, uint64_t now) {
+    thread_pool_tuner_t *tuner = &pool->tuner;
+    uint64_t elapsed = now - tuner->last_tick;
+    if (elapsed < THREAD_POOL_TUNE_WINDOW_MS) return;
+
+    size_t count = thread_pool_throughput_count(pool);
+    double rate = (double)(count - tuner->last_count) * 1000.0 / (double)elapsed;
+    tuner->last_tick = now;
+    tuner->last_count = count;
 
-        if (pool->shutdown_requested && pool->active_work_items == 0 && pool->queued_work_items == 0) {
-            SetEvent(pool->done_event);
+    // Idle workers mean the tree, not the worker count, is the limit;
+    // a window like that says nothing about concurrency
+    if (rate <= 0.0 || atomic_load(&pool->sleepers) > 0) {
+        tuner->last_rate = 0.0;
+        return;
+    }
+
+    if (tuner->last_rate > 0.0) {
+        if (rate < tuner->last_rate * (1.0 - THREAD_POOL_TUNE_TOLERANCE)) {
+            tuner->direction = -tuner->direction;
+            tuner->flat_windows = 0;
+        } else if (rate <= tuner->last_rate * (1.0 + THREAD_POOL_TUNE_TOLERANCE) &&
+                   ++tuner->flat_windows < THREAD_POOL_TUNE_HOLD_WINDOWS) {
+            tuner->last_rate = rate;
+            return;
+        } else {
+            tuner->flat_windows = 0;
         }
-        LeaveCriticalSection(&pool->queue_lock);
+    }
+    tuner->last_rate = rate;
+
+    size_t limit = atomic_load(&pool->active_limit);
+    size_t step = limit / 4 > 0 ? limit / 4 : 1;
+    size_t next;
+    if (tuner->direction > 0) {
+        next = limit + step <= pool->thread_count ? limit + step : pool->thread_count;
+    } else {
+        next = limit > step ? limit - step : 1;
+    }
+    if (next == limit) {
+        // At a bound: probe the other way next time
+        tuner->direction = -tuner->direction;
+        return;
+    }
+
+    thread_pool_set_limit(pool, next);
+}
+
+// Returns false once progress_cb has asked to stop; that raises stop_flag
+// and wakes the waiter
+static bool thread_pool_report_progress(thread_pool_t *pool) {
+    bool keep_going = true;
 
-        free(item);
+    platform_mutex_lock(&pool->progress_lock);
+    if (pool->progress_waiting) {
+        keep_going = pool->config.progress_cb(atomic_load(&pool->completed_work_items),
+                                              atomic_load(&pool->active_work_items),
+                                              pool->config.progress_user_data);
     }
+    platform_mutex_unlock(&pool->progress_lock);
+
+    if (!keep_going) {
+        if (pool->config.stop_flag) {
+            atomic_store(pool->config.stop_flag, true);
+        }
+        atomic_store(&pool->progress_cancelled, true);
+        platform_event_set(&pool->done_event);
+    }
+    return keep_going;
+}
+
+static void thread_pool_monitor_thread(void *param) {
+    thread_pool_t *pool = (thread_pool_t*)param;
+    bool reporting = pool->config.progress_cb != NULL;
+
+    pool->tuner.last_tick = platform_tick_ms();
+    pool->tuner.last_count = thread_pool_throughput_count(pool);
+
+    do {
+        if (pool->config.adaptive_threads) {
+            thread_pool_tune(pool, platform_tick_ms());
+        }
+        if (reporting) {
+            reporting = thread_pool_report_progress(pool);
+        }
+    } while (!platform_event_wait(&pool->monitor_stop_event, pool->monitor_interval));
+}
+
+// Without the monitor the search still runs, just without progress or tuning
+static void thread_pool_start_monitor(thread_pool_t *pool) {
+    pool->monitor_started = true;
+    pool->progress_waiting = true;
+    pool->monitor_running = platform_thread_create(&pool->monitor_thread, thread_pool_monitor_thread, pool);
+}
+
+static void thread_pool_set_waiting(thread_pool_t *pool, bool waiting) {
+    if (!pool->monitor_running) return;
+    platform_mutex_lock(&pool->progress_lock);
+    pool->progress_waiting = waiting;
+    platform_mutex_unlock(&pool->progress_lock);
+}
 
+static int thread_pool_compare_cpus(const void *a, const void *b) {
+    const platform_cpu_t *left = (const platform_cpu_t*)a;
+    const platform_cpu_t *right = (const platform_cpu_t*)b;
+    if (left->node != right->node) return left->node < right->node ? -1 : 1;
+    if (left->id != right->id) return left->id < right->id ? -1 : 1;
     return 0;
 }
 
+// Give worker i the i-th allowed CPU, filling one node before the next, so
+// the first workers the tuner runs share a socket. Extra workers wrap around.
+static void thread_pool_place_workers(thread_pool_t *pool) {
+    size_t cpu_count = platform_cpu_count();
+    platform_cpu_t *cpus = (platform_cpu_t*)malloc(cpu_count * sizeof(platform_cpu_t));
+    if (!cpus) return;
+
+    cpu_count = platform_cpu_topology(cpus, cpu_count);
+    if (cpu_count > 0) {
+        qsort(cpus, cpu_count, sizeof(platform_cpu_t), thread_pool_compare_cpus);
+        for (size_t i = 0; i < pool->thread_count; i++) {
+            const platform_cpu_t *cpu = &cpus[i % cpu_count];
+            pool->workers[i].cpu = (int)cpu->id;
+            pool->workers[i].node = cpu->node;
+        }
+
+        size_t used = cpu_count < pool->thread_count ? cpu_count : pool->thread_count;
+        pool->numa_nodes = 1;
+        for (size_t i = 1; i < used; i++) {
+            if (cpus[i].node != cpus[i - 1].node) {
+                pool->numa_nodes++;
+            }
+        }
+    }
+    free(cpus);
+}
+
+static void thread_pool_release_resources(thread_pool_t *pool, size_t deque_count) {
+    // Items still queued never ran; their user_data goes back through the
+    // release callback before the slab holding both is torn down
+    work_release_t release = pool->config.work_release;
+    for (size_t i = 0; i < deque_count; i++) {
+        deque_destroy(&pool->workers[i].deque, pool->slab, release);
+    }
+
+    work_item_t *item = pool->inject_head;
+    while (item) {
+        work_item_t *next = item->next;
+        work_item_drop(pool->slab, release, item);
+        item = next;
+    }
+    for (size_t i = 0; i < THREAD_POOL_PRIORITY_LEVELS; i++) {
+        item = pool->priority_heads[i];
+        while (item) {
+            work_item_t *next = item->next;
+            work_item_drop(pool->slab, release, item);
+            item = next;
+        }
+    }
+    for (size_t i = 0; i < THREAD_POOL_MAX_DEVICES; i++) {
+        item = pool->devices[i].parked_head;
+        while (item) {
+            work_item_t *next = item->next;
+            work_item_drop(pool->slab, release, item);
+            item = next;
+        }
+    }
+    slab_destroy(pool->slab);
+
+    platform_mutex_destroy(&pool->progress_lock);
+    platform_mutex_destroy(&pool->inject_lock);
+    platform_mutex_destroy(&pool->priority_lock);
+    platform_mutex_destroy(&pool->park_lock);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
 thread_pool_t* thread_pool_create(const thread_pool_config_t *config) {
     if (!config) return NULL;
 
@@ -88,180 +993,268 @@ thread_pool_t* thread_pool_create(const thread_pool_config_t *config) {
 
     pool->config = *config;
 
-    SYSTEM_INFO sysinfo;
-    GetSystemInfo(&sysinfo);
-    size_t hw_threads = sysinfo.dwNumberOfProcessors > 0 ? sysinfo.dwNumberOfProcessors : 4;
+    size_t hw_threads = platform_cpu_count();
     pool->thread_count = config->max_threads > 0 ? config->max_threads : hw_threads;
+    size_t initial_threads = pool->thread_count;
+    if (config->adaptive_threads) {
+        // max_threads is only a ceiling; I/O-bound storage may want more
+        // workers than cores, so the default ceiling leaves room to grow.
+        // The cap only limits that headroom, never one worker per core.
+        if (config->max_threads == 0) {
+            size_t ceiling = hw_threads * 4 < THREAD_POOL_ADAPTIVE_MAX_THREADS
+                           ? hw_threads * 4 : THREAD_POOL_ADAPTIVE_MAX_THREADS;
+            pool->thread_count = ceiling > hw_threads ? ceiling : hw_threads;
+        }
+        initial_threads = hw_threads < pool->thread_count ? hw_threads : pool->thread_count;
+    }
+    atomic_init(&pool->active_limit, 0);
+    pool->tuner.direction = 1;
+    pool->numa_nodes = 1;
 
-    pool->active_work_items = 0;
-    pool->completed_work_items = 0;
-    pool->total_submitted = 0;
-    pool->queued_work_items = 0;
-
-    InitializeCriticalSection(&pool->queue_lock);
-    pool->work_semaphore = CreateSemaphoreA(NULL, 0, LONG_MAX, NULL);
-    pool->done_event = CreateEventA(NULL, TRUE, FALSE, NULL);
-    if (!pool->work_semaphore || !pool->done_event) {
-        if (pool->work_semaphore) CloseHandle(pool->work_semaphore);
-        if (pool->done_event) CloseHandle(pool->done_event);
-        DeleteCriticalSection(&pool->queue_lock);
-        free(pool);
-        return NULL;
+    atomic_init(&pool->injected, 0);
+    atomic_init(&pool->prioritized, 0);
+    pool->priority_lowest = THREAD_POOL_PRIORITY_LEVELS;
+    atomic_init(&pool->busy_devices, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->parks, 0);
+    atomic_init(&pool->wakeups, 0);
+    pool->spin_rounds = hw_threads > 1 ? THREAD_POOL_SPIN_ROUNDS : 0;
+    atomic_init(&pool->shutdown, false);
+    atomic_init(&pool->progress_cancelled, false);
+    pool->monitor_interval = config->progress_interval_ms > 0 ? config->progress_interval_ms
+                                                              : THREAD_POOL_PROGRESS_INTERVAL_MS;
+    atomic_init(&pool->pending_work_items, 0);
+    atomic_init(&pool->active_work_items, 0);
+    atomic_init(&pool->completed_work_items, 0);
+    atomic_init(&pool->total_submitted, 0);
+    atomic_init(&pool->inline_work_items, 0);
+    for (size_t i = 0; i < THREAD_POOL_MAX_DEVICES; i++) {
+        atomic_init(&pool->devices[i].state, DEVICE_SLOT_FREE);
+        atomic_init(&pool->devices[i].outstanding, 0);
+        atomic_init(&pool->devices[i].in_flight, 0);
+        atomic_init(&pool->devices[i].parked, 0);
     }
 
-    pool->threads = (HANDLE*)calloc(pool->thread_count, sizeof(HANDLE));
-    if (!pool->threads) {
-        CloseHandle(pool->work_semaphore);
-        DeleteCriticalSection(&pool->queue_lock);
-        free(pool);
+    platform_mutex_init(&pool->inject_lock);
+    platform_mutex_init(&pool->priority_lock);
+    platform_mutex_init(&pool->park_lock);
+    platform_mutex_init(&pool->progress_lock);
+    platform_event_init(&pool->done_event, false);
+    platform_event_init(&pool->monitor_stop_event, false);
+    pool->threads = (platform_thread_t*)calloc(pool->thread_count, sizeof(platform_thread_t));
+    pool->workers = (thread_pool_worker_t*)calloc(pool->thread_count, sizeof(thread_pool_worker_t));
+    pool->slab = slab_create();
+    if (!pool->threads || !pool->workers || !pool->slab) {
+        thread_pool_release_resources(pool, 0);
         return NULL;
     }
 
+    long long capacity = THREAD_POOL_MIN_DEQUE_CAPACITY;
+    while ((size_t)capacity < config->queue_size_hint && capacity < (1LL << 20)) {
+        capacity *= 2;
+    }
     for (size_t i = 0; i < pool->thread_count; i++) {
-        pool->threads[i] = CreateThread(NULL, 0, thread_pool_worker, pool, 0, NULL);
-        if (!pool->threads[i]) {
-            pool->thread_count = i;
-            break;
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->workers[i].rng = (uint32_t)(i * 2654435761u) | 1u;
+        pool->workers[i].cpu = -1;
+        atomic_init(&pool->workers[i].busy_ns, 0);
+        atomic_init(&pool->workers[i].idle_ns, 0);
+        atomic_init(&pool->workers[i].steals, 0);
+        pool->workers[i].cache = slab_cache_create(pool->slab);
+        atomic_init(&pool->workers[i].park_state, WORKER_RUNNING);
+        if (!pool->workers[i].cache || !deque_init(&pool->workers[i].deque, capacity)) {
+            thread_pool_release_resources(pool, i);
+            return NULL;
         }
     }
 
-    if (pool->thread_count == 0) {
-        CloseHandle(pool->work_semaphore);
-        DeleteCriticalSection(&pool->queue_lock);
-        free(pool->threads);
-        free(pool);
+    if (config->pin_threads) {
+        thread_pool_place_workers(pool);
+    }
+
+    // Workers read thread_count while later threads are still starting, so
+    // it stays fixed; slots past started_count just have empty deques
+    thread_pool_set_limit(pool, initial_threads);
+
+    if (pool->started_count == 0) {
+        thread_pool_release_resources(pool, pool->thread_count);
         return NULL;
     }
 
     return pool;
 }
 
+// Objects from a worker come out of its own slab cache; anything else
+// (the submitting thread, oversized requests) falls back to the heap
+static slab_cache_t* thread_pool_local_cache(thread_pool_t *pool) {
+    thread_pool_worker_t *worker = current_worker;
+    return (worker && worker->pool == pool) ? worker->cache : NULL;
+}
+
+void* thread_pool_alloc_object(thread_pool_t *pool, size_t size) {
+    if (!pool) return NULL;
+    return slab_alloc(pool->slab, thread_pool_local_cache(pool), size);
+}
+
+void thread_pool_free_object(thread_pool_t *pool, void *ptr) {
+    if (!pool || !ptr) return;
+    slab_free(pool->slab, thread_pool_local_cache(pool), ptr);
+}
+
 bool thread_pool_submit(thread_pool_t *pool, work_function_t work_func, void *user_data) {
+    return thread_pool_submit_to_device(pool, work_func, user_data, 0);
+}
+
+bool thread_pool_submit_to_device(thread_pool_t *pool, work_function_t work_func, void *user_data,
+                                  uint64_t device) {
+    return thread_pool_submit_prioritized(pool, work_func, user_data, device, 0);
+}
+
+bool thread_pool_submit_prioritized(thread_pool_t *pool, work_function_t work_func, void *user_data,
+                                    uint64_t device, unsigned int priority) {
     if (!pool || !work_func) return false;
 
-    if (pool->config.stop_flag && atomic_load(pool->config.stop_flag)) {
+    if (thread_pool_stopping(pool)) {
         return false;
     }
 
-    work_item_t *item = (work_item_t*)malloc(sizeof(work_item_t));
+    work_item_t *item = (work_item_t*)thread_pool_alloc_object(pool, sizeof(work_item_t));
     if (!item) return false;
 
     item->work_func = work_func;
     item->user_data = user_data;
+    item->device = device_slot_for(pool, device);
+    item->priority = priority;
     item->next = NULL;
 
-    EnterCriticalSection(&pool->queue_lock);
-    if (pool->queue_tail) {
-        pool->queue_tail->next = item;
-        pool->queue_tail = item;
-    } else {
-        pool->queue_head = pool->queue_tail = item;
+    if (atomic_fetch_add(&item->device->outstanding, 1) == 0) {
+        atomic_fetch_add(&pool->busy_devices, 1);
     }
-    pool->queued_work_items++;
-    pool->total_submitted++;
-    // new work means completion not reached
-    ResetEvent(pool->done_event);
-    LeaveCriticalSection(&pool->queue_lock);
+    atomic_fetch_add(&pool->pending_work_items, 1);
+    atomic_fetch_add(&pool->total_submitted, 1);
 
-    ReleaseSemaphore(pool->work_semaphore, 1, NULL);
+    // Workers keep what they discover; only outside submits take the lock
+    thread_pool_worker_t *worker = current_worker;
+    thread_pool_enqueue(pool, (worker && worker->pool == pool) ? worker : NULL, item);
 
+    thread_pool_wake(pool, 1);
     return true;
 }
 
+bool thread_pool_has_idle_workers(thread_pool_t *pool) {
+    return pool && atomic_load_explicit(&pool->sleepers, memory_order_relaxed) > 0;
+}
+
+void thread_pool_count_inline(thread_pool_t *pool, size_t count) {
+    if (!pool) return;
+    atomic_fetch_add_explicit(&pool->inline_work_items, count, memory_order_relaxed);
+}
+
 bool thread_pool_wait_completion(thread_pool_t *pool, DWORD timeout_ms) {
     if (!pool) return false;
 
-    EnterCriticalSection(&pool->queue_lock);
-    pool->shutdown_requested = true;
-    ResetEvent(pool->done_event);
-    bool already_done = (pool->active_work_items == 0 && pool->queued_work_items == 0);
-    LeaveCriticalSection(&pool->queue_lock);
-
-    if (already_done) {
-        return true;
-    }
+    uint64_t start = platform_tick_ms();
+    bool done = false;
+    thread_pool_set_waiting(pool, true);
 
-    DWORD start = GetTickCount();
     for (;;) {
-        size_t active, queued, completed;
-        EnterCriticalSection(&pool->queue_lock);
-        active = pool->active_work_items;
-        queued = pool->queued_work_items;
-        completed = pool->completed_work_items;
-        LeaveCriticalSection(&pool->queue_lock);
-
-        if (active == 0 && queued == 0) {
-            return true;
+        // Reset before checking: the worker that takes pending to zero
+        // sets the event after its decrement, so the wake cannot be lost
+        platform_event_reset(&pool->done_event);
+
+        if (atomic_exchange(&pool->progress_cancelled, false)) {
+            break;
+        }
+        if (atomic_load(&pool->pending_work_items) == 0) {
+            done = true;
+            break;
         }
 
+        uint64_t elapsed = platform_tick_ms() - start;
+        uint32_t wait_ms = PLATFORM_WAIT_INFINITE;
         if (timeout_ms != INFINITE) {
-            DWORD elapsed = GetTickCount() - start;
             if (elapsed >= timeout_ms) {
-                return false;
+                break;
             }
+            wait_ms = (uint32_t)(timeout_ms - elapsed);
         }
 
-        if (pool->config.progress_cb) {
-            if (!pool->config.progress_cb(completed, active, pool->config.progress_user_data)) {
-                if (pool->config.stop_flag) {
-                    atomic_store(pool->config.stop_flag, true);
-                }
-                return false;
+        // Quick searches finish before the first tick and never start the timer
+        if ((pool->config.progress_cb || pool->config.adaptive_threads) && !pool->monitor_started) {
+            if (elapsed >= pool->monitor_interval) {
+                thread_pool_start_monitor(pool);
+            } else if (pool->monitor_interval - elapsed < wait_ms) {
+                wait_ms = (uint32_t)(pool->monitor_interval - elapsed);
             }
         }
 
-        DWORD wait_slice = (timeout_ms == INFINITE) ? 50 : (timeout_ms < 50 ? timeout_ms : 50);
-        DWORD wait_result = WaitForSingleObject(pool->done_event, wait_slice);
-        if (wait_result == WAIT_OBJECT_0) {
-            // signaled; loop will re-check counts
-            continue;
-        }
+        platform_event_wait(&pool->done_event, wait_ms);
     }
+
+    thread_pool_set_waiting(pool, false);
+    return done;
 }
 
 void thread_pool_destroy(thread_pool_t *pool) {
     if (!pool) return;
 
-    if (pool->config.stop_flag) {
-        atomic_store(pool->config.stop_flag, true);
+    if (pool->monitor_running) {
+        platform_event_set(&pool->monitor_stop_event);
+        platform_thread_join(pool->monitor_thread);
     }
 
-    for (size_t i = 0; i < pool->thread_count; i++) {
-        ReleaseSemaphore(pool->work_semaphore, 1, NULL);
+    atomic_store(&pool->shutdown, true);
+    if (pool->config.stop_flag) {
+        atomic_store(pool->config.stop_flag, true);
     }
 
-    WaitForMultipleObjects((DWORD)pool->thread_count, pool->threads, TRUE, 5000);
-
-    for (size_t i = 0; i < pool->thread_count; i++) {
-        if (pool->threads[i]) {
-            CloseHandle(pool->threads[i]);
+    // Parkers re-check shutdown after announcing, so this reaches them all
+    for (size_t i = 0; i < pool->started_count; i++) {
+        thread_pool_worker_t *worker = &pool->workers[i];
+        if (atomic_exchange(&worker->park_state, WORKER_NOTIFIED) == WORKER_PARKED) {
+            atomic_fetch_sub(&pool->sleepers, 1);
         }
+        worker_park_signal(worker);
     }
 
-    CloseHandle(pool->work_semaphore);
-    CloseHandle(pool->done_event);
-    DeleteCriticalSection(&pool->queue_lock);
-
-    work_item_t *item = pool->queue_head;
-    while (item) {
-        work_item_t *next = item->next;
-        free(item);
-        item = next;
+    for (size_t i = 0; i < pool->started_count; i++) {
+        platform_thread_join(pool->threads[i]);
     }
 
-    free(pool->threads);
-    free(pool);
+    thread_pool_release_resources(pool, pool->thread_count);
 }
 
 bool thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats) {
     if (!pool || !stats) return false;
 
-    EnterCriticalSection(&pool->queue_lock);
-    stats->active_threads = pool->active_work_items;
-    stats->queued_work_items = pool->queued_work_items;
-    stats->completed_work_items = pool->completed_work_items;
-    stats->total_submitted = pool->total_submitted;
-    LeaveCriticalSection(&pool->queue_lock);
+    size_t pending = atomic_load(&pool->pending_work_items);
+    stats->active_threads = atomic_load(&pool->active_work_items);
+    stats->queued_work_items = pending > stats->active_threads ? pending - stats->active_threads : 0;
+    stats->completed_work_items = atomic_load(&pool->completed_work_items);
+    stats->total_submitted = atomic_load(&pool->total_submitted);
+    stats->inline_work_items = atomic_load_explicit(&pool->inline_work_items, memory_order_relaxed);
+    stats->worker_limit = atomic_load(&pool->active_limit);
+    stats->max_workers = pool->thread_count;
+    stats->numa_nodes = pool->numa_nodes;
+
+    slab_stats_t slab_stats;
+    slab_get_stats(pool->slab, &slab_stats);
+    stats->slab_reused = slab_stats.reused;
+    stats->slab_carved = slab_stats.carved;
+    stats->heap_allocs = slab_stats.heap_allocs;
+    stats->remote_frees = slab_stats.remote_frees;
+    stats->remote_batches = slab_stats.remote_batches;
+    stats->parks = atomic_load_explicit(&pool->parks, memory_order_relaxed);
+    stats->wakeups = atomic_load_explicit(&pool->wakeups, memory_order_relaxed);
+    stats->steals = 0;
+    stats->busy_ns = 0;
+    stats->idle_ns = 0;
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        stats->steals += atomic_load_explicit(&pool->workers[i].steals, memory_order_relaxed);
+        stats->busy_ns += atomic_load_explicit(&pool->workers[i].busy_ns, memory_order_relaxed);
+        stats->idle_ns += atomic_load_explicit(&pool->workers[i].idle_ns, memory_order_relaxed);
+    }
 
     return true;
 }
@@ -2,9 +2,9 @@
 #define THREAD_POOL_H
 
 #include "compat.h"
-#include <windows.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 
 typedef struct thread_pool thread_pool_t;
@@ -13,12 +13,48 @@ typedef void (*work_function_t)(void *context, void *user_data);
 
 typedef bool (*progress_callback_t)(size_t processed_files, size_t queued_dirs, void *user_data);
 
+// Per-worker state: the value returned by worker_init is passed as the
+// context argument of every work function run on that worker.
+typedef void* (*worker_init_t)(void *user_data);
+typedef void (*worker_cleanup_t)(void *worker_context, void *user_data);
+
+// Frees what a work item's user_data holds when the item is dropped unrun
+typedef void (*work_release_t)(void *user_data);
+
+// Which queued item a worker runs next
+typedef enum {
+    THREAD_POOL_ORDER_LIFO,     // newest first from the worker's own queue (depth-first)
+    THREAD_POOL_ORDER_FIFO,     // oldest first from the worker's own queue (breadth-first)
+    THREAD_POOL_ORDER_PRIORITY  // lowest priority value first, across one shared queue
+} thread_pool_order_t;
+
 typedef struct {
     size_t max_threads;
     size_t queue_size_hint;
     progress_callback_t progress_cb;
     void *progress_user_data;
+    // How often progress_cb runs during wait_completion; 0 = 50 ms
+    DWORD progress_interval_ms;
     atomic_bool *stop_flag;
+    worker_init_t worker_init;
+    worker_cleanup_t worker_cleanup;
+    void *worker_user_data;
+    // Called on destroy for each work item still queued (after a stop or a
+    // timeout); NULL = user_data needs no cleanup
+    work_release_t work_release;
+    // Work items running at once per device; 0 = split the workers evenly
+    // across the devices that currently have work
+    size_t per_device_limit;
+    // Tune the number of running workers by measured throughput, between 1
+    // and max_threads (0 = a ceiling of several workers per core)
+    bool adaptive_threads;
+    // What the tuner maximizes per second (e.g. directory entries read);
+    // NULL = completed work items
+    atomic_size_t *throughput_counter;
+    thread_pool_order_t order;
+    // Pin each worker to one allowed CPU, filling NUMA nodes in turn;
+    // thieves then prefer victims on their own node
+    bool pin_threads;
 } thread_pool_config_t;
 
 // Create a new thread pool with the given config
@@ -27,7 +63,31 @@ thread_pool_t* thread_pool_create(const thread_pool_config_t *config);
 // Submit work to be done - returns false if queue is full or pool is shutting down
 bool thread_pool_submit(thread_pool_t *pool, work_function_t work_func, void *user_data);
 
-// Wait for all work to finish, with optional timeout
+// Submit work that will block on the given device (see platform_dir_device);
+// items for a device over its limit wait while other devices' work runs
+bool thread_pool_submit_to_device(thread_pool_t *pool, work_function_t work_func, void *user_data,
+                                  uint64_t device);
+
+// True while some worker is parked for lack of work. Work functions that
+// can run follow-up work themselves should submit it when this is set.
+bool thread_pool_has_idle_workers(thread_pool_t *pool);
+
+// Record work a caller ran directly instead of submitting (see stats)
+void thread_pool_count_inline(thread_pool_t *pool, size_t count);
+
+// Allocate/free small objects that are made on one worker and often freed
+// on another (e.g. per-item payloads). Worker threads use their own slab
+// cache; other threads get plain heap blocks. Valid until thread_pool_destroy.
+void* thread_pool_alloc_object(thread_pool_t *pool, size_t size);
+void thread_pool_free_object(thread_pool_t *pool, void *ptr);
+
+// Like thread_pool_submit_to_device; with THREAD_POOL_ORDER_PRIORITY, lower
+// values run first (other orders ignore it)
+bool thread_pool_submit_prioritized(thread_pool_t *pool, work_function_t work_func, void *user_data,
+                                    uint64_t device, unsigned int priority);
+
+// Wait for all work to finish, with optional timeout. Returns as soon as
+// the last item completes; false on timeout or when progress_cb cancels.
 bool thread_pool_wait_completion(thread_pool_t *pool, DWORD timeout_ms);
 
 // Clean up and destroy the pool
@@ -38,6 +98,22 @@ typedef struct {
     size_t queued_work_items;
     size_t completed_work_items;
     size_t total_submitted;
+    size_t inline_work_items;   // run by the caller instead (thread_pool_count_inline)
+    size_t worker_limit;        // workers currently allowed to run (tuned when adaptive)
+    size_t max_workers;
+    size_t numa_nodes;          // nodes the pinned workers span; 1 when not pinned
+    // Work item and pool object allocations (see thread_pool_alloc_object)
+    size_t slab_reused;         // served from a worker's free list
+    size_t slab_carved;         // cut from a fresh slab chunk
+    size_t heap_allocs;         // no worker cache, or too large for a slab
+    size_t remote_frees;        // freed on a worker other than the allocating one
+    size_t remote_batches;      // batches of remote frees handed back
+    size_t parks;               // times a worker went to sleep after spinning
+    size_t wakeups;             // parked workers woken by new work
+    size_t steals;              // items taken from another worker's queue
+    // Summed over workers; time spent retired by the tuner counts as neither
+    uint64_t busy_ns;           // running work functions
+    uint64_t idle_ns;           // looking for work: popping, stealing, spinning, parked
 } thread_pool_stats_t;
 
 bool thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats);
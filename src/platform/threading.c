@@ -0,0 +1,285 @@
+#ifdef _WIN32
+    #ifndef _WIN32_WINNT
+        #define _WIN32_WINNT 0x0602     // WaitOnAddress
+    #endif
+#endif
+
+#include "threading.h"
+#include <stdlib.h>
+
+typedef struct {
+    platform_thread_func_t func;
+    void *arg;
+} platform_thread_start_t;
+
+#ifdef _WIN32
+
+static DWORD WINAPI platform_thread_trampoline(LPVOID param) {
+    platform_thread_start_t start = *(platform_thread_start_t*)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+bool platform_thread_create(platform_thread_t *thread, platform_thread_func_t func, void *arg) {
+    platform_thread_start_t *start = (platform_thread_start_t*)malloc(sizeof(platform_thread_start_t));
+    if (!start) return false;
+    start->func = func;
+    start->arg = arg;
+
+    *thread = CreateThread(NULL, 0, platform_thread_trampoline, start, 0, NULL);
+    if (!*thread) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void platform_thread_join(platform_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+void platform_mutex_init(platform_mutex_t *mutex) { InitializeSRWLock(mutex); }
+void platform_mutex_destroy(platform_mutex_t *mutex) { (void)mutex; }
+void platform_mutex_lock(platform_mutex_t *mutex) { AcquireSRWLockExclusive(mutex); }
+void platform_mutex_unlock(platform_mutex_t *mutex) { ReleaseSRWLockExclusive(mutex); }
+
+void platform_wait_on_address(atomic_uint *address, unsigned int expected, uint32_t timeout_ms) {
+    WaitOnAddress((volatile VOID*)address, &expected, sizeof(expected),
+                  timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : timeout_ms);
+}
+
+void platform_wake_address_one(atomic_uint *address) { WakeByAddressSingle((PVOID)address); }
+void platform_wake_address_all(atomic_uint *address) { WakeByAddressAll((PVOID)address); }
+
+size_t platform_cpu_count(void) {
+    DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    return count > 0 ? count : 1;
+}
+
+uint64_t platform_tick_ms(void) {
+    return GetTickCount64();
+}
+
+uint64_t platform_tick_ns(void) {
+    static LARGE_INTEGER frequency;     // fixed at boot, so a racing first call is harmless
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t ticks = (uint64_t)counter.QuadPart;
+    uint64_t per_second = (uint64_t)frequency.QuadPart;
+    return ticks / per_second * 1000000000u + ticks % per_second * 1000000000u / per_second;
+}
+
+// Affinity masks cover the current processor group only
+size_t platform_cpu_topology(platform_cpu_t *cpus, size_t max) {
+    DWORD_PTR process_mask, system_mask;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (uint32_t cpu = 0; cpu < sizeof(DWORD_PTR) * 8 && count < max; cpu++) {
+        if (!(process_mask & ((DWORD_PTR)1 << cpu))) continue;
+        UCHAR node = 0;
+        if (!GetNumaProcessorNode((UCHAR)cpu, &node) || node == 0xFF) {
+            node = 0;
+        }
+        cpus[count].id = cpu;
+        cpus[count].node = node;
+        count++;
+    }
+    return count;
+}
+
+bool platform_thread_pin(uint32_t cpu) {
+    if (cpu >= sizeof(DWORD_PTR) * 8) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+}
+
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static void* platform_thread_trampoline(void *param) {
+    platform_thread_start_t start = *(platform_thread_start_t*)param;
+    free(param);
+    start.func(start.arg);
+    return NULL;
+}
+
+bool platform_thread_create(platform_thread_t *thread, platform_thread_func_t func, void *arg) {
+    platform_thread_start_t *start = (platform_thread_start_t*)malloc(sizeof(platform_thread_start_t));
+    if (!start) return false;
+    start->func = func;
+    start->arg = arg;
+
+    if (pthread_create(thread, NULL, platform_thread_trampoline, start) != 0) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void platform_thread_join(platform_thread_t thread) {
+    pthread_join(thread, NULL);
+}
+
+void platform_mutex_init(platform_mutex_t *mutex) { pthread_mutex_init(mutex, NULL); }
+void platform_mutex_destroy(platform_mutex_t *mutex) { pthread_mutex_destroy(mutex); }
+void platform_mutex_lock(platform_mutex_t *mutex) { pthread_mutex_lock(mutex); }
+void platform_mutex_unlock(platform_mutex_t *mutex) { pthread_mutex_unlock(mutex); }
+
+void platform_wait_on_address(atomic_uint *address, unsigned int expected, uint32_t timeout_ms) {
+    struct timespec timeout;
+    struct timespec *timeout_ptr = NULL;
+    if (timeout_ms != PLATFORM_WAIT_INFINITE) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        timeout_ptr = &timeout;
+    }
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, timeout_ptr, NULL, 0);
+}
+
+void platform_wake_address_one(atomic_uint *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void platform_wake_address_all(atomic_uint *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+size_t platform_cpu_count(void) {
+    // Honour taskset/cgroup cpusets, which the online count ignores
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        int count = CPU_COUNT(&set);
+        if (count > 0) return (size_t)count;
+    }
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+}
+
+uint64_t platform_tick_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+uint64_t platform_tick_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Tag every allowed CPU listed in a sysfs cpulist ("0-3,8-11") with node
+static void platform_read_node_cpus(const char *path, uint32_t node, platform_cpu_t *cpus, size_t count) {
+    FILE *file = fopen(path, "r");
+    if (!file) return;
+
+    char list[4096];
+    if (fgets(list, sizeof(list), file)) {
+        char *cursor = list;
+        while (*cursor && *cursor != '\n') {
+            char *end;
+            unsigned long first = strtoul(cursor, &end, 10);
+            if (end == cursor) break;
+            unsigned long last = first;
+            if (*end == '-') {
+                cursor = end + 1;
+                last = strtoul(cursor, &end, 10);
+                if (end == cursor) break;
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (cpus[i].id >= first && cpus[i].id <= last) {
+                    cpus[i].node = node;
+                }
+            }
+            cursor = *end == ',' ? end + 1 : end;
+        }
+    }
+    fclose(file);
+}
+
+size_t platform_cpu_topology(platform_cpu_t *cpus, size_t max) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        cpus[count].id = cpu;
+        cpus[count].node = 0;
+        count++;
+    }
+
+    // Node numbers can be sparse, so list the directory rather than count up
+    DIR *nodes = opendir("/sys/devices/system/node");
+    if (nodes) {
+        struct dirent *entry;
+        while ((entry = readdir(nodes)) != NULL) {
+            char *end;
+            if (strncmp(entry->d_name, "node", 4) != 0) continue;
+            unsigned long node = strtoul(entry->d_name + 4, &end, 10);
+            if (end == entry->d_name + 4 || *end != '\0') continue;
+
+            char path[128];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%lu/cpulist", node);
+            platform_read_node_cpus(path, (uint32_t)node, cpus, count);
+        }
+        closedir(nodes);
+    }
+    return count;
+}
+
+bool platform_thread_pin(uint32_t cpu) {
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#endif
+
+void platform_event_init(platform_event_t *event, bool set) {
+    atomic_init(&event->state, set ? 1u : 0u);
+}
+
+void platform_event_set(platform_event_t *event) {
+    if (atomic_exchange(&event->state, 1u) == 0u) {
+        platform_wake_address_all(&event->state);
+    }
+}
+
+void platform_event_reset(platform_event_t *event) {
+    atomic_store(&event->state, 0u);
+}
+
+bool platform_event_wait(platform_event_t *event, uint32_t timeout_ms) {
+    uint64_t start = platform_tick_ms();
+
+    while (atomic_load(&event->state) == 0u) {
+        uint32_t remaining = PLATFORM_WAIT_INFINITE;
+        if (timeout_ms != PLATFORM_WAIT_INFINITE) {
+            uint64_t elapsed = platform_tick_ms() - start;
+            if (elapsed >= timeout_ms) return false;
+            remaining = (uint32_t)(timeout_ms - elapsed);
+        }
+        platform_wait_on_address(&event->state, 0u, remaining);
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef THREADING_H
+#define THREADING_H
+
+#include "compat.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Thin threading layer under the scheduler: pthreads and futexes on Linux,
+// SRW locks and WaitOnAddress on Windows. Both sides behave the same, so
+// the pool can be profiled natively on either.
+
+#define PLATFORM_WAIT_INFINITE UINT32_MAX
+
+#ifdef _WIN32
+typedef HANDLE platform_thread_t;
+typedef SRWLOCK platform_mutex_t;
+#else
+#include <pthread.h>
+typedef pthread_t platform_thread_t;
+typedef pthread_mutex_t platform_mutex_t;
+#endif
+
+typedef void (*platform_thread_func_t)(void *arg);
+
+bool platform_thread_create(platform_thread_t *thread, platform_thread_func_t func, void *arg);
+void platform_thread_join(platform_thread_t thread);
+
+void platform_mutex_init(platform_mutex_t *mutex);
+void platform_mutex_destroy(platform_mutex_t *mutex);
+void platform_mutex_lock(platform_mutex_t *mutex);
+void platform_mutex_unlock(platform_mutex_t *mutex);
+
+// Sleep while *address still equals expected, for at most timeout_ms.
+// May return early or spuriously; callers re-check their condition.
+void platform_wait_on_address(atomic_uint *address, unsigned int expected, uint32_t timeout_ms);
+void platform_wake_address_one(atomic_uint *address);
+void platform_wake_address_all(atomic_uint *address);
+
+// Manual-reset event on a single word; needs no cleanup
+typedef struct {
+    atomic_uint state;      // 0 = clear, 1 = set
+} platform_event_t;
+
+void platform_event_init(platform_event_t *event, bool set);
+void platform_event_set(platform_event_t *event);
+void platform_event_reset(platform_event_t *event);
+// True if the event is set, false on timeout
+bool platform_event_wait(platform_event_t *event, uint32_t timeout_ms);
+
+// Processors this process may run on
+size_t platform_cpu_count(void);
+
+typedef struct {
+    uint32_t id;        // as accepted by platform_thread_pin
+    uint32_t node;      // NUMA node; 0 without NUMA information
+} platform_cpu_t;
+
+// Fill cpus with up to max processors this process may run on, in id
+// order; returns how many were written
+size_t platform_cpu_topology(platform_cpu_t *cpus, size_t max);
+// Restrict the calling thread to one processor
+bool platform_thread_pin(uint32_t cpu);
+// Monotonic milliseconds
+uint64_t platform_tick_ms(void);
+// Monotonic nanoseconds, for timing short phases
+uint64_t platform_tick_ns(void);
+
+#endif
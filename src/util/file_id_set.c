@@ -0,0 +1,118 @@
+#include "file_id_set.h"
+#include "../platform/threading.h"
+#include <stdlib.h>
+
+#define FILE_ID_SET_SHARD_BITS 6
+#define FILE_ID_SET_SHARDS (1u << FILE_ID_SET_SHARD_BITS)
+#define FILE_ID_SET_INITIAL_CAPACITY 64
+
+typedef struct {
+    uint64_t device;    // 0 marks an empty slot
+    uint64_t inode;
+} file_id_entry_t;
+
+typedef struct {
+    platform_mutex_t lock;
+    file_id_entry_t *slots;
+    size_t capacity;    // power of two
+    size_t count;
+    char pad[64];       // keep neighbouring shard locks off this cache line
+} file_id_shard_t;
+
+struct file_id_set {
+    file_id_shard_t shards[FILE_ID_SET_SHARDS];
+};
+
+static uint64_t file_id_hash(uint64_t device, uint64_t inode) {
+    // splitmix64 finalizer over both halves
+    uint64_t x = inode ^ (device * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+file_id_set_t* file_id_set_create(void) {
+    file_id_set_t *set = (file_id_set_t*)calloc(1, sizeof(file_id_set_t));
+    if (!set) return NULL;
+
+    for (size_t i = 0; i < FILE_ID_SET_SHARDS; i++) {
+        platform_mutex_init(&set->shards[i].lock);
+    }
+    return set;
+}
+
+void file_id_set_destroy(file_id_set_t *set) {
+    if (!set) return;
+
+    for (size_t i = 0; i < FILE_ID_SET_SHARDS; i++) {
+        platform_mutex_destroy(&set->shards[i].lock);
+        free(set->shards[i].slots);
+    }
+    free(set);
+}
+
+static void shard_place(file_id_entry_t *slots, size_t capacity, uint64_t hash,
+                        uint64_t device, uint64_t inode) {
+    size_t mask = capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (slots[i].device != 0) {
+        i = (i + 1) & mask;
+    }
+    slots[i].device = device;
+    slots[i].inode = inode;
+}
+
+// Keep the load factor under 3/4; caller holds the shard lock
+static bool shard_reserve(file_id_shard_t *shard) {
+    if ((shard->count + 1) * 4 <= shard->capacity * 3) {
+        return true;
+    }
+
+    size_t capacity = shard->capacity ? shard->capacity * 2 : FILE_ID_SET_INITIAL_CAPACITY;
+    file_id_entry_t *slots = (file_id_entry_t*)calloc(capacity, sizeof(file_id_entry_t));
+    if (!slots) return false;
+
+    for (size_t i = 0; i < shard->capacity; i++) {
+        file_id_entry_t *entry = &shard->slots[i];
+        if (entry->device != 0) {
+            shard_place(slots, capacity, file_id_hash(entry->device, entry->inode),
+                        entry->device, entry->inode);
+        }
+    }
+
+    free(shard->slots);
+    shard->slots = slots;
+    shard->capacity = capacity;
+    return true;
+}
+
+bool file_id_set_insert(file_id_set_t *set, uint64_t device, uint64_t inode) {
+    if (!set || device == 0) return true;
+
+    uint64_t hash = file_id_hash(device, inode);
+    // Top bits pick the shard, low bits the slot, so the two stay independent
+    file_id_shard_t *shard = &set->shards[hash >> (64 - FILE_ID_SET_SHARD_BITS)];
+
+    platform_mutex_lock(&shard->lock);
+
+    if (shard->capacity > 0) {
+        size_t mask = shard->capacity - 1;
+        for (size_t i = (size_t)hash & mask; shard->slots[i].device != 0; i = (i + 1) & mask) {
+            if (shard->slots[i].device == device && shard->slots[i].inode == inode) {
+                platform_mutex_unlock(&shard->lock);
+                return false;
+            }
+        }
+    }
+
+    if (shard_reserve(shard)) {
+        shard_place(shard->slots, shard->capacity, hash, device, inode);
+        shard->count++;
+    }
+
+    platform_mutex_unlock(&shard->lock);
+    return true;
+}
@@ -0,0 +1,18 @@
+#ifndef FILE_ID_SET_H
+#define FILE_ID_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Concurrent set of (device, inode) pairs. Sharded by hash so that threads
+// inserting different ids rarely touch the same lock.
+typedef struct file_id_set file_id_set_t;
+
+file_id_set_t* file_id_set_create(void);
+void file_id_set_destroy(file_id_set_t *set);
+
+// Returns true if the id was not in the set yet. device must be nonzero.
+// If the set cannot grow, the id is reported as new rather than dropped.
+bool file_id_set_insert(file_id_set_t *set, uint64_t device, uint64_t inode);
+
+#endif
@@ -2,7 +2,6 @@
 #define UTILS_H
 
 #include "../platform/compat.h"
-#include <windows.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>